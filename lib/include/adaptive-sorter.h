@@ -0,0 +1,93 @@
+#pragma once
+#include "planner.h"
+#include "polyphase.h"
+#include "radix.h"
+#include "sample-sorter.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <span>
+#include <stdexcept>
+
+namespace tape {
+  /**
+   * Put elements from @code in@endcode to @code out@endcode in the sorted order. <br>
+   * The @code helpers::presortedness@endcode statistics and the sample for the splitters are gathered while
+   * @code in@endcode is read, then the sorting strategy is chosen by @code choose_strategy()@endcode:
+   * - the sorted data is copied and the reverse sorted data is copied backward from @code in@endcode
+   * - the data with no more than @code chunk_size / 4@endcode distinct elements is counted in memory
+   * - the data of no more than @code chunk_size@endcode elements is sorted in memory
+   * - the data consisting of few runs is sorted by @code natural_sort()@endcode
+   * - if the comparator is @code radix_compatible@endcode, the data is sorted by @code radix_sort()@endcode
+   * - otherwise, the data is sorted by @code sample_sort()@endcode
+   *
+   * Among the last three the strategy with the least emulated time (see @code operation_counts@endcode) on the
+   * delays of the @code tmps@endcode is chosen, so the rules above only break the ties.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The sort is not stable.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param tmps at least 3 temporary tapes. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
+   * @throws std::invalid_argument if less than 3 temporary tapes are given
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+  void sort(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps, const size_t chunk_size = 0,
+            Compare compare = Compare(), const size_t threads = 1) {
+    if (tmps.size() < 3) {
+      throw std::invalid_argument("at least 3 temporary tapes expected");
+    }
+
+    helpers::random_generator gen(std::random_device{}());
+    auto info = helpers::sample_info(tmps.size() - 1, compare, gen);
+    helpers::presortedness<Compare> stats(compare, chunk_size / 2);
+    while (!in.is_end()) {
+      const int32_t value = in.get();
+      in.next();
+      info.update(value);
+      stats.update(value);
+    }
+
+    const strategy chosen = choose_strategy(stats, chunk_size, tmps.size(), tmps[0].get_delays());
+    if (chosen == strategy::reverse) {
+      for (size_t i = 0; i < stats.size(); ++i) {
+        helpers::put(out, helpers::peek(in));
+      }
+      return;
+    }
+
+    in.seek(-stats.size());
+    switch (chosen) {
+    case strategy::copy:
+      helpers::copy(in, out, stats.size());
+      break;
+    case strategy::counting:
+      helpers::put_counts(stats, out);
+      break;
+    case strategy::memory:
+      ::tape::sort(in, out, compare, chunk_size - stats.size(), threads);
+      break;
+    case strategy::merge:
+      natural_sort(in, out, tmps, chunk_size, compare, threads);
+      break;
+    case strategy::radix:
+      if constexpr (radix_compatible<Compare>) {
+        const auto key = radix_key<Compare>::key;
+        helpers::radix_sort_impl(in, out, tmps, {stats.size(), key(stats.min()), key(stats.max())}, chunk_size,
+                                 compare, threads);
+      }
+      break;
+    default:
+      helpers::sample_sort_impl(in, out, tmps, info, chunk_size, compare, threads);
+    }
+  }
+} // namespace tape
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdexcept>
+
+namespace tape {
+  /**
+   * Exception, which is thrown when the data expected to be sorted is not sorted.
+   */
+  class unsorted_exception : public std::runtime_error {
+  public:
+    explicit unsorted_exception(const std::string& string);
+
+    explicit unsorted_exception(const char* string);
+  };
+} // namespace tape
\ No newline at end of file
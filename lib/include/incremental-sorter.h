@@ -0,0 +1,234 @@
+#pragma once
+#include "adaptive-sorter.h"
+#include "merger.h"
+#include "output.h"
+#include "tape.h"
+
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * Reader of the elements of the vector in their order.
+     */
+    class vector_reader {
+    private:
+      const std::vector<int32_t>* vec_;
+      size_t next_ = 0;
+
+    public:
+      explicit vector_reader(const std::vector<int32_t>& vec) : vec_(&vec) {}
+
+      /**
+       * @return @code true@endcode if all the elements are read.
+       */
+      [[nodiscard]] bool empty() const {
+        return next_ == vec_->size();
+      }
+
+      /**
+       * Read the next element.
+       */
+      int32_t read() {
+        assert(!empty());
+        return (*vec_)[next_++];
+      }
+    };
+
+    /**
+     * Merge the elements read by @code left@endcode and @code right@endcode and @code put()@endcode the result in
+     * @code out@endcode.<br>
+     * @code Left@endcode and @code Right@endcode should provide @code bool empty()@endcode and
+     * @code int32_t read()@endcode and read the elements in the order defined by @code compare@endcode.
+     * Among the equivalent elements the ones from @code left@endcode are put first.<br>
+     * Unlike the @code loser_tree@endcode, the sources can be of different types.
+     *
+     * @return count of the elements put
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename Out, typename Left, typename Right, typename Compare>
+      requires(output<Out>)
+    size_t merge_two(Left left, Right right, Out& out, Compare compare) {
+      size_t count = 0;
+      bool has_left = !left.empty();
+      bool has_right = !right.empty();
+      int32_t l = has_left ? left.read() : 0;
+      int32_t r = has_right ? right.read() : 0;
+      for (; has_left && has_right; ++count) {
+        if (compare(r, l)) {
+          put(out, r);
+          has_right = !right.empty();
+          r = has_right ? right.read() : 0;
+        } else {
+          put(out, l);
+          has_left = !left.empty();
+          l = has_left ? left.read() : 0;
+        }
+      }
+      for (; has_left; ++count) {
+        put(out, l);
+        has_left = !left.empty();
+        l = has_left ? left.read() : 0;
+      }
+      for (; has_right; ++count) {
+        put(out, r);
+        has_right = !right.empty();
+        r = has_right ? right.read() : 0;
+      }
+      return count;
+    }
+
+    /**
+     * @return comparator of the opposite order to the @code compare@endcode. The @code natural_order@endcode
+     * comparators are mapped to the opposite standard functors, so the specializations for them are kept.
+     */
+    template <typename Compare>
+    auto reversed(Compare compare) {
+      if constexpr (std::is_same_v<Compare, std::less<int32_t>>) {
+        return std::greater<int32_t>();
+      } else if constexpr (std::is_same_v<Compare, std::greater<int32_t>>) {
+        return std::less<int32_t>();
+      } else if constexpr (std::is_same_v<Compare, std::less<>>) {
+        return std::greater<>();
+      } else if constexpr (std::is_same_v<Compare, std::greater<>>) {
+        return std::less<>();
+      } else {
+        return [compare](const int32_t l, const int32_t r) { return compare(r, l); };
+      }
+    }
+
+    /**
+     * Count the elements after the @code in@endcode head by moving the head forward and back, no elements are read.
+     */
+    template <typename TIn>
+    size_t count_elements(tape<TIn>& in) {
+      size_t size = 0;
+      for (; !in.is_end(); ++size) {
+        in.next();
+      }
+      in.seek(-size);
+      return size;
+    }
+  } // namespace helpers
+
+  /**
+   * Sort the new elements from @code batch@endcode and merge them with the sorted elements from @code existing@endcode
+   * to @code out@endcode in a single pass, so the sorted data is not sorted again.<br>
+   * If the batch fits in memory, it is sorted in memory. Otherwise, it is sorted by the @code sort()@endcode with
+   * the temporary tapes to @code tmps[0]@endcode in the reversed order, so it is @code peek()@endcode-ed in the sorted
+   * order by the merge with no rewinds. The @code existing@endcode data is read in blocks by the
+   * @code helpers::sorted_reader@endcode, which checks that it is sorted.<br>
+   * Among the equivalent elements the existing ones are put first.<br>
+   * @code existing@endcode and @code batch@endcode are not changed after the call, even if it throws the
+   * @code unsorted_exception@endcode.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * elements, but at least one element for the block of the @code existing@endcode data.
+   *
+   * @param existing tape with the sorted elements. Can be read-only. The head should be at the beginning of the data.
+   * The data lasts till the end of the tape
+   * @param batch tape with the new elements. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param tmps temporary tapes, at least 4 if the batch does not fit in memory. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the batch
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements of the batch in memory
+   * @return count of the elements put
+   * @throws std::invalid_argument if the batch does not fit in memory and less than 4 temporary tapes are given
+   * @throws unsorted_exception if the @code existing@endcode data is not sorted
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TExisting, typename TBatch, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TExisting>::READABLE && tape<TBatch>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+  size_t merge_batch(tape<TExisting>& existing, tape<TBatch>& batch, tape<TOut>& out, std::span<tape<T>> tmps,
+                     const size_t chunk_size = 0, Compare compare = Compare(), const size_t threads = 1) {
+    const size_t size = helpers::count_elements(batch);
+
+    if (size > chunk_size && tmps.size() < 4) {
+      throw std::invalid_argument("at least 4 temporary tapes expected");
+    }
+
+    size_t existing_size = 0;
+    size_t count;
+    try {
+      if (size <= chunk_size) {
+        std::vector<int32_t> vec;
+        vec.reserve(size);
+        while (!batch.is_end()) {
+          vec.push_back(batch.get());
+          batch.next();
+        }
+        batch.seek(-size);
+        helpers::sort_leaf(vec, compare, chunk_size - size, threads);
+
+        count = helpers::merge_two(helpers::sorted_reader(existing, 0, chunk_size - size, compare, existing_size),
+                                   helpers::vector_reader(vec), out, compare);
+      } else {
+        ::tape::sort(batch, tmps[0], tmps.subspan(1), chunk_size, helpers::reversed(compare), threads);
+        count = helpers::merge_two(helpers::sorted_reader(existing, 0, chunk_size, compare, existing_size),
+                                   helpers::run_reader(tmps[0], size), out, compare);
+      }
+    } catch (const unsorted_exception&) {
+      existing.seek(-existing_size);
+      throw;
+    }
+    existing.seek(-existing_size);
+    return count;
+  }
+
+  /**
+   * Sort the new elements from @code batch@endcode and put them to @code existing@endcode after its sorted data,
+   * if none of them is less than the last element of the data, so the data stays sorted.
+   * Otherwise, nothing is put.<br>
+   * The batch is sorted by the @code sort()@endcode with the temporary tapes.<br>
+   * @code batch@endcode is not changed after the call.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code existing@endcode head is after the last elements put after the call, or is not moved if the batch
+   * is not put.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory.
+   *
+   * @param existing tape with the sorted elements before the head. Must be readable and writable.
+   * Should have at least as much space after the head as the size of the batch
+   * @param batch tape with the new elements. Can be read-only. The head should be at the beginning of the data
+   * @param tmps at least 3 temporary tapes. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the batch
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements of the batch in memory
+   * @return @code true@endcode if the batch is put
+   * @throws std::invalid_argument if less than 3 temporary tapes are given
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TExisting, typename TBatch, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TExisting>::BIDIRECTIONAL && tape<TBatch>::READABLE && tape<T>::BIDIRECTIONAL)
+  bool append_batch(tape<TExisting>& existing, tape<TBatch>& batch, std::span<tape<T>> tmps,
+                    const size_t chunk_size = 0, Compare compare = Compare(), const size_t threads = 1) {
+    if (tmps.size() < 3) {
+      throw std::invalid_argument("at least 3 temporary tapes expected");
+    }
+    if (!existing.is_begin()) {
+      const int32_t last = helpers::peek(existing);
+      existing.next();
+
+      size_t size = 0;
+      bool greater = true;
+      for (; !batch.is_end() && greater; ++size) {
+        greater = !compare(batch.get(), last);
+        batch.next();
+      }
+      batch.seek(-size);
+      if (!greater) {
+        return false;
+      }
+    }
+
+    ::tape::sort(batch, existing, tmps, chunk_size, compare, threads);
+    return true;
+  }
+} // namespace tape
@@ -0,0 +1,236 @@
+#pragma once
+#include "leaf-sort.h"
+#include "output.h"
+#include "tape.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * Pipeline, which sorts the leaves in memory and writes them to the output tape in the background.
+     * So while the leaf is sorted and the previous one is written, the next one can be read by the caller.<br>
+     * The leaves are sorted by the sorter thread and written by the writer thread in the order they are submitted.
+     * Before each leaf the given count of copies of the key is written, so the keys of the splits are kept in order.
+     * <br>
+     * The elements of the leaves, which are not written yet, the scratch memory of their sorting and the memory
+     * reserved by the caller are counted against the budget. The caller reserves the memory for the elements before
+     * it reads them, so the total memory of the elements does not exceed the budget.<br>
+     * The caller should not access the output tape until the @code wait()@endcode call.
+     */
+    template <typename Out, typename Compare>
+      requires(output<Out>)
+    class leaf_pipeline {
+    private:
+      /**
+       * The leaf, which is written after @code copies@endcode copies of the @code key@endcode.
+       */
+      class job {
+      public:
+        int32_t key;
+        size_t copies;
+        std::vector<int32_t> elements;
+        bool sorted;
+      };
+
+      Out& out_;
+      Compare compare_;
+      size_t budget_;
+      size_t threads_;
+
+      std::mutex mutex_;
+      std::condition_variable changed_;
+      size_t used_ = 0;
+      size_t reserved_ = 0;
+      size_t pending_ = 0;
+      std::deque<job> to_sort_;
+      std::deque<job> to_write_;
+      bool stopped_ = false;
+      std::exception_ptr error_;
+
+      std::jthread sorter_;
+      std::jthread writer_;
+
+      /**
+       * Take the next job of the @code jobs@endcode or @code false@endcode if the pipeline is stopped.
+       */
+      bool take(std::deque<job>& jobs, job& next) {
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [&] { return stopped_ || !jobs.empty(); });
+        if (stopped_) {
+          return false;
+        }
+        next = std::move(jobs.front());
+        jobs.pop_front();
+        return true;
+      }
+
+      /**
+       * Stop the pipeline with the current exception, which is thrown to the caller.
+       */
+      void fail() {
+        std::lock_guard lock(mutex_);
+        error_ = std::current_exception();
+        stopped_ = true;
+        changed_.notify_all();
+      }
+
+      void sort_loop() {
+        job next;
+        while (take(to_sort_, next)) {
+          try {
+            if (!next.sorted) {
+              // the scratch memory is taken only if it is free now, so the sorter never waits for the caller
+              size_t scratch = 0;
+              {
+                std::lock_guard lock(mutex_);
+                const size_t wanted = leaf_scratch_size<Compare>(next.elements.size());
+                if (used_ + wanted <= budget_) {
+                  scratch = wanted;
+                  used_ += scratch;
+                }
+              }
+              sort_leaf(next.elements, compare_, scratch, threads_);
+              next.sorted = true;
+
+              std::lock_guard lock(mutex_);
+              used_ -= scratch;
+            }
+          } catch (...) {
+            fail();
+            return;
+          }
+
+          std::lock_guard lock(mutex_);
+          to_write_.push_back(std::move(next));
+          changed_.notify_all();
+        }
+      }
+
+      void write_loop() {
+        job next;
+        while (take(to_write_, next)) {
+          try {
+            put_copies(out_, next.key, next.copies);
+            for (const int32_t value : next.elements) {
+              put(out_, value);
+            }
+          } catch (...) {
+            fail();
+            return;
+          }
+
+          std::lock_guard lock(mutex_);
+          used_ -= next.elements.size();
+          --pending_;
+          changed_.notify_all();
+        }
+      }
+
+      /**
+       * Throw the error of the sorter or the writer thread, if any. The mutex should be locked.
+       */
+      void check() const {
+        if (error_) {
+          std::rethrow_exception(error_);
+        }
+      }
+
+    public:
+      /**
+       * @param out tape to write the leaves. Its head is after the last elements written after the @code wait()@endcode
+       * @param compare comparator which defines the ordering
+       * @param budget the maximum count of the elements, which are held by the pipeline and the caller
+       * @param threads the maximum count of the threads, which sort a leaf by the @code sort_leaf()@endcode
+       */
+      leaf_pipeline(Out& out, Compare compare, const size_t budget, const size_t threads)
+          : out_(out),
+            compare_(compare),
+            budget_(budget),
+            threads_(threads),
+            sorter_([this] { sort_loop(); }),
+            writer_([this] { write_loop(); }) {}
+
+      leaf_pipeline(const leaf_pipeline& other) = delete;
+      leaf_pipeline& operator=(const leaf_pipeline& other) = delete;
+
+      /**
+       * Stop the threads. The jobs, which are not written yet, are dropped.
+       */
+      ~leaf_pipeline() {
+        std::lock_guard lock(mutex_);
+        stopped_ = true;
+        changed_.notify_all();
+      }
+
+      /**
+       * Make the memory reserved by the caller at least @code size@endcode elements.
+       * If they do not fit in the budget, wait until the previous leaves are written. All the free memory is
+       * reserved, so the caller can grow its buffer element by element with few waits.<br>
+       * If the pipeline is empty, the memory is reserved even if it exceeds the budget.
+       * @throws io_exception if writing of some of the previous leaves failed
+       */
+      void reserve(const size_t size) {
+        if (size <= reserved_) {
+          return;
+        }
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [&] { return error_ || used_ - reserved_ + size <= budget_ || pending_ == 0; });
+        check();
+        const size_t reserved = std::max(size, reserved_ + budget_ - std::min(used_, budget_));
+        used_ += reserved - reserved_;
+        reserved_ = reserved;
+      }
+
+      /**
+       * @return count of the elements reserved by the caller.
+       */
+      [[nodiscard]] size_t reserved() const {
+        return reserved_;
+      }
+
+      /**
+       * Free the memory reserved by the caller, which is not submitted.
+       */
+      void release() {
+        std::lock_guard lock(mutex_);
+        used_ -= reserved_;
+        reserved_ = 0;
+        changed_.notify_all();
+      }
+
+      /**
+       * Submit the leaf to be sorted and written after @code copies@endcode copies of the @code key@endcode.<br>
+       * The memory reserved by the caller is passed to the leaf. If less memory is reserved than the
+       * @code elements@endcode take, the budget can be exceeded.
+       * @param sorted @code true@endcode if the elements are sorted already
+       * @throws io_exception if writing of some of the previous leaves failed
+       */
+      void submit(const int32_t key, const size_t copies, std::vector<int32_t> elements, const bool sorted = false) {
+        std::lock_guard lock(mutex_);
+        check();
+        const size_t from_reserved = std::min(reserved_, elements.size());
+        used_ += elements.size() - from_reserved;
+        reserved_ -= from_reserved;
+        ++pending_;
+        to_sort_.push_back({key, copies, std::move(elements), sorted});
+        changed_.notify_all();
+      }
+
+      /**
+       * Wait until all the submitted leaves are written, so the output tape can be accessed.
+       * @throws io_exception if writing of some of the leaves failed
+       */
+      void wait() {
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [&] { return error_ || pending_ == 0; });
+        check();
+      }
+    };
+  } // namespace helpers
+} // namespace tape
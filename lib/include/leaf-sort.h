@@ -0,0 +1,271 @@
+#pragma once
+#include "projection.h"
+#include "radix-key.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * The count of the bits of the key, which are handled by a pass of the @code lsd_radix_sort()@endcode.
+     * So the keys are sorted in 3 passes and the counters of a pass fit in L1 cache.
+     */
+    constexpr int LEAF_RADIX_BITS = 11;
+
+    /**
+     * The minimum size of the subarray, which is sorted by the @code lsd_radix_sort()@endcode.
+     * The smaller subarrays are sorted faster by comparisons than the counters are cleared.
+     */
+    constexpr size_t LEAF_RADIX_MIN_SIZE = size_t{1} << 12;
+
+    /**
+     * The minimum count of the elements per thread of the @code parallel_sort()@endcode.
+     * The smaller parts are sorted faster than a thread is started.
+     */
+    constexpr size_t PARALLEL_MIN_SIZE = size_t{1} << 16;
+
+    /**
+     * The count of the sample elements, which are taken to choose the pivot of the @code parallel_sort()@endcode.
+     */
+    constexpr size_t PARALLEL_SAMPLE_SIZE = 63;
+
+    /**
+     * @return @code true@endcode if the CPU supports the vectorized kernel of the @code sort_int32()@endcode.
+     */
+    bool vectorized_sort_supported();
+
+    /**
+     * Sort @code size@endcode elements starting at @code data@endcode in the ascending order.<br>
+     * If the CPU supports AVX2, the quick sort with the vectorized partition and the sorting networks for
+     * the small subarrays is used. Otherwise, @code std::sort@endcode is used.
+     */
+    void sort_int32(int32_t* data, size_t size);
+
+    /**
+     * Sort the elements of the @code data@endcode in the order of their @code radix_key@endcode with the
+     * <a href="https://en.wikipedia.org/wiki/Radix_sort#Least_significant_digit">LSD radix sort</a>
+     * by the digits of @code LEAF_RADIX_BITS@endcode bits.<br>
+     * The counters of all the digits are gathered in a single pass, and the digits, which are the same for all
+     * the keys, are skipped. Each other digit takes a pass, which moves the elements between the @code data@endcode
+     * and a scratch buffer of the same size. The sort is stable.
+     */
+    template <typename Compare>
+      requires(radix_compatible<Compare>)
+    void lsd_radix_sort(const std::span<int32_t> data) {
+      constexpr size_t DIGITS = (32 + LEAF_RADIX_BITS - 1) / LEAF_RADIX_BITS;
+      constexpr uint32_t MASK = (uint32_t{1} << LEAF_RADIX_BITS) - 1;
+
+      std::vector<std::array<size_t, MASK + 1>> counts(DIGITS);
+      for (const int32_t value : data) {
+        const uint32_t key = radix_key<Compare>::key(value);
+        for (size_t d = 0; d < DIGITS; ++d) {
+          ++counts[d][key >> (d * LEAF_RADIX_BITS) & MASK];
+        }
+      }
+
+      std::vector<int32_t> scratch;
+      std::span<int32_t> source = data;
+      for (size_t d = 0; d < DIGITS; ++d) {
+        const int shift = static_cast<int>(d * LEAF_RADIX_BITS);
+        auto& offsets = counts[d];
+        if (std::find(offsets.begin(), offsets.end(), data.size()) != offsets.end()) {
+          continue;
+        }
+
+        size_t offset = 0;
+        for (auto& count : offsets) {
+          offset += std::exchange(count, offset);
+        }
+        scratch.resize(data.size());
+        const std::span<int32_t> target = source.data() == data.data() ? std::span(scratch) : data;
+        for (const int32_t value : source) {
+          target[offsets[radix_key<Compare>::key(value) >> shift & MASK]++] = value;
+        }
+        source = target;
+      }
+      if (source.data() != data.data()) {
+        std::copy(source.begin(), source.end(), data.begin());
+      }
+    }
+
+    /**
+     * Sort the elements of the @code data@endcode in memory in a single thread.<br>
+     * If the comparator is @code radix_compatible@endcode, the @code data@endcode has at least
+     * @code LEAF_RADIX_MIN_SIZE@endcode elements and no more than @code scratch_size@endcode, the
+     * @code lsd_radix_sort()@endcode is used. So its scratch buffer of the @code data.size()@endcode elements can be
+     * counted against the memory limit by the caller.<br>
+     * If the comparator is @code keyed@endcode and the (key, element) pairs fit in the @code scratch_size@endcode,
+     * the elements are sorted by the @code sort_cached_keys()@endcode.<br>
+     * Otherwise, for @code std::less@endcode and @code std::greater@endcode the @code sort_int32()@endcode is used,
+     * and @code std::sort@endcode with the comparator for the other ones.
+     */
+    template <typename Compare>
+    void sort_range(const std::span<int32_t> data, Compare compare, const size_t scratch_size) {
+      if constexpr (radix_compatible<Compare>) {
+        if (data.size() >= LEAF_RADIX_MIN_SIZE && data.size() <= scratch_size) {
+          lsd_radix_sort<Compare>(data);
+          return;
+        }
+      }
+      if constexpr (keyed<Compare>) {
+        if (sort_cached_keys(data, compare, scratch_size)) {
+          return;
+        }
+      }
+
+      if constexpr (std::is_same_v<Compare, std::less<int32_t>> || std::is_same_v<Compare, std::less<>>) {
+        sort_int32(data.data(), data.size());
+      } else if constexpr (std::is_same_v<Compare, std::greater<int32_t>> || std::is_same_v<Compare, std::greater<>>) {
+        // the equal elements are the same, so the reversed ascending order is the descending one
+        sort_int32(data.data(), data.size());
+        std::reverse(data.begin(), data.end());
+      } else {
+        std::sort(data.begin(), data.end(), compare);
+      }
+    }
+
+    /**
+     * @return count of the elements of the scratch memory, which the @code sort_range()@endcode uses to sort
+     * @code size@endcode elements faster.
+     */
+    template <typename Compare>
+    constexpr size_t leaf_scratch_size(const size_t size) {
+      if constexpr (radix_compatible<Compare>) {
+        if (size >= LEAF_RADIX_MIN_SIZE) {
+          return size;
+        }
+      }
+      if constexpr (keyed<Compare>) {
+        return cached_keys_size<Compare>(size);
+      }
+      return 0;
+    }
+
+    /**
+     * Sort the elements of the @code data@endcode in memory with @code threads@endcode threads.<br>
+     * The data is split into about @code 2 * threads@endcode parts by the 3-way partitions around the medians of
+     * the samples, so each part precedes the next one in the sorted order, and the elements, which are equal
+     * to the pivots, are in their places already. The partitions are done in place, so no memory is allocated
+     * for them. Then the parts are sorted by the @code sort_range()@endcode, the largest ones first,
+     * and each thread takes the next part when it is done with the previous one.<br>
+     * Each thread gets @code scratch_size / threads@endcode elements of the scratch memory for its parts,
+     * so the parts sorted at the same time keep the memory limit.
+     */
+    template <typename Compare>
+    void parallel_sort(const std::span<int32_t> data, Compare compare, const size_t threads,
+                       const size_t scratch_size) {
+      std::vector<std::span<int32_t>> parts{data};
+      while (parts.size() < 2 * threads) {
+        const auto largest = std::max_element(parts.begin(), parts.end(),
+                                              [](const auto& l, const auto& r) { return l.size() < r.size(); });
+        const std::span<int32_t> part = *largest;
+        if (part.size() < 2 * PARALLEL_MIN_SIZE) {
+          break;
+        }
+
+        std::array<int32_t, PARALLEL_SAMPLE_SIZE> sample;
+        for (size_t i = 0; i < sample.size(); ++i) {
+          sample[i] = part[i * part.size() / sample.size()];
+        }
+        const auto middle = sample.begin() + sample.size() / 2;
+        std::nth_element(sample.begin(), middle, sample.end(), compare);
+        const int32_t pivot = *middle;
+
+        const auto less = std::partition(part.begin(), part.end(), [&](const int32_t v) { return compare(v, pivot); });
+        const auto equal = std::partition(less, part.end(), [&](const int32_t v) { return !compare(pivot, v); });
+        *largest = part.subspan(0, less - part.begin());
+        parts.push_back(part.subspan(equal - part.begin()));
+      }
+
+      std::sort(parts.begin(), parts.end(), [](const auto& l, const auto& r) { return l.size() > r.size(); });
+      const size_t thread_scratch = scratch_size / threads;
+      std::atomic<size_t> next = 0;
+      auto work = [&] {
+        for (size_t i = next++; i < parts.size(); i = next++) {
+          sort_range(parts[i], compare, thread_scratch);
+        }
+      };
+
+      std::vector<std::jthread> workers;
+      workers.reserve(threads - 1);
+      for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+      }
+      work();
+    }
+
+    /**
+     * Comparators, for which the equivalent elements are equal, so any sort of them is stable.
+     */
+    template <typename Compare>
+    concept natural_order = std::is_same_v<Compare, std::less<int32_t>> || std::is_same_v<Compare, std::less<>> ||
+                            std::is_same_v<Compare, std::greater<int32_t>> || std::is_same_v<Compare, std::greater<>>;
+
+    /**
+     * Sort the elements of the @code vec@endcode in memory.<br>
+     * If the @code vec@endcode is large enough to give each of the @code threads@endcode threads at least
+     * @code PARALLEL_MIN_SIZE@endcode elements, the @code parallel_sort()@endcode is used.
+     * Otherwise, the elements are sorted by the @code sort_range()@endcode.
+     *
+     * @param vec elements to sort
+     * @param compare comparator which defines the ordering
+     * @param scratch_size the maximum count of the elements, which can be allocated in addition to the
+     * @code vec@endcode
+     * @param threads the maximum count of the threads, which sort the elements
+     */
+    template <typename Compare>
+    void sort_leaf(std::vector<int32_t>& vec, Compare compare,
+                   const size_t scratch_size = std::numeric_limits<size_t>::max(), const size_t threads = 1) {
+      const size_t used_threads = std::min(threads, vec.size() / PARALLEL_MIN_SIZE);
+      if (used_threads > 1) {
+        parallel_sort(std::span(vec), compare, used_threads, scratch_size);
+      } else {
+        sort_range(std::span(vec), compare, scratch_size);
+      }
+    }
+
+    /**
+     * Sort the elements of the @code vec@endcode in memory keeping the order of the equivalent elements.<br>
+     * For the @code natural_order@endcode comparators the @code sort_leaf()@endcode is used.
+     * For the other @code radix_compatible@endcode comparators the @code lsd_radix_sort()@endcode is used if it
+     * is allowed by the @code sort_range()@endcode, for the @code keyed@endcode ones the pairs of the
+     * @code sort_cached_keys()@endcode are sorted stably. Otherwise, @code std::stable_sort@endcode is used.
+     *
+     * @param vec elements to sort
+     * @param compare comparator which defines the ordering
+     * @param scratch_size the maximum count of the elements, which can be allocated in addition to the
+     * @code vec@endcode
+     * @param threads the maximum count of the threads, which sort the elements by the @code sort_leaf()@endcode
+     */
+    template <typename Compare>
+    void stable_sort_leaf(std::vector<int32_t>& vec, Compare compare,
+                          const size_t scratch_size = std::numeric_limits<size_t>::max(), const size_t threads = 1) {
+      if constexpr (natural_order<Compare>) {
+        sort_leaf(vec, compare, scratch_size, threads);
+        return;
+      }
+      if constexpr (radix_compatible<Compare>) {
+        if (vec.size() >= LEAF_RADIX_MIN_SIZE && vec.size() <= scratch_size) {
+          lsd_radix_sort<Compare>(std::span(vec));
+          return;
+        }
+      }
+      if constexpr (keyed<Compare>) {
+        if (sort_cached_keys(std::span(vec), compare, scratch_size, true)) {
+          return;
+        }
+      }
+      std::stable_sort(vec.begin(), vec.end(), compare);
+    }
+  } // namespace helpers
+} // namespace tape
@@ -0,0 +1,375 @@
+#pragma once
+#include "exceptions/unsorted_exception.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * Reader of the run which lies right before the tape head.<br>
+     * By default, the elements are @code peek()@endcode-ed, so the run is read in the reversed order.
+     * If the run is read forward, the head is moved to the leftmost element of the run first
+     * and the elements are read in the original order.<br>
+     * The tape head is at the leftmost element of the run after the whole run is read.
+     */
+    template <typename T>
+      requires(tape<T>::READABLE)
+    class run_reader {
+    private:
+      tape<T>* tape_;
+      size_t size_;
+
+      /**
+       * Size of the run if it is read forward, 0 otherwise.
+       */
+      size_t forward_size_;
+
+    public:
+      /**
+       * @param current tape with the run before the head
+       * @param size size of the run
+       * @param forward @code true@endcode if the run should be read in the original order.
+       * Reading forward costs two rewinds by the size of the run
+       */
+      run_reader(tape<T>& current, const size_t size, const bool forward = false)
+          : tape_(&current),
+            size_(size),
+            forward_size_(forward ? size : 0) {
+        if (forward_size_ != 0) {
+          current.seek(-forward_size_);
+        }
+      }
+
+      /**
+       * @return @code true@endcode if all the elements of the run are read.
+       */
+      [[nodiscard]] bool empty() const {
+        return size_ == 0;
+      }
+
+      /**
+       * Read the next element of the run.
+       * @throws io_exception if reading fails
+       */
+      int32_t read() {
+        assert(!empty());
+        --size_;
+        if (forward_size_ == 0) {
+          return peek(*tape_);
+        }
+
+        const int32_t value = tape_->get();
+        tape_->next();
+        if (size_ == 0) {
+          tape_->seek(-forward_size_);
+        }
+        return value;
+      }
+    };
+
+    /**
+     * Reader of the elements after the tape head, which moves the head forward as the input tapes are read.
+     */
+    template <typename T>
+      requires(tape<T>::READABLE)
+    class input_reader {
+    private:
+      tape<T>* tape_;
+      size_t size_;
+
+    public:
+      input_reader(tape<T>& current, const size_t size) : tape_(&current), size_(size) {}
+
+      /**
+       * @return @code true@endcode if all the elements are read.
+       */
+      [[nodiscard]] bool empty() const {
+        return size_ == 0;
+      }
+
+      /**
+       * Read the next element.
+       * @throws io_exception if reading fails
+       */
+      int32_t read() {
+        assert(!empty());
+        --size_;
+        const int32_t value = tape_->get();
+        tape_->next();
+        return value;
+      }
+    };
+
+    /**
+     * Reader of the sorted elements after the tape head till the end of the tape, which reads the elements in blocks
+     * of @code buffer_size@endcode elements, so the tape is read sequentially between the reads of the other tapes.
+     * The order of the elements is checked as they are read.<br>
+     * The count of the elements read from the tape, including the buffered ones, is stored in @code *count@endcode,
+     * so the head can be moved back by it.
+     */
+    template <typename T, typename Compare>
+      requires(tape<T>::READABLE)
+    class sorted_reader {
+    private:
+      tape<T>* tape_;
+      size_t* count_;
+      size_t index_;
+      size_t buffer_size_;
+      Compare compare_;
+      std::vector<int32_t> buffer_;
+      size_t next_ = 0;
+      size_t read_ = 0;
+
+      /**
+       * Read the next block of the elements.
+       * @throws io_exception if reading fails
+       */
+      void fill() {
+        buffer_.clear();
+        next_ = 0;
+        while (buffer_.size() < buffer_size_ && !tape_->is_end()) {
+          buffer_.push_back(tape_->get());
+          tape_->next();
+          ++*count_;
+        }
+      }
+
+    public:
+      /**
+       * @param current tape with the elements after the head
+       * @param index index of the tape, which is reported if the elements are not sorted
+       * @param buffer_size the maximum count of the elements read at once, at least 1
+       * @param compare comparator which defines the ordering
+       * @param count where to store the count of the elements read from the tape
+       */
+      sorted_reader(tape<T>& current, const size_t index, const size_t buffer_size, Compare compare, size_t& count)
+          : tape_(&current),
+            count_(&count),
+            index_(index),
+            buffer_size_(std::max<size_t>(buffer_size, 1)),
+            compare_(compare) {
+        *count_ = 0;
+      }
+
+      /**
+       * @return @code true@endcode if all the elements are read.
+       */
+      [[nodiscard]] bool empty() const {
+        return next_ == buffer_.size() && tape_->is_end();
+      }
+
+      /**
+       * Read the next element.
+       * @throws unsorted_exception if the element is less than the previous one
+       * @throws io_exception if reading fails
+       */
+      int32_t read() {
+        assert(!empty());
+        const bool first = read_ == 0;
+        const int32_t last = first ? 0 : buffer_[next_ - 1];
+        if (next_ == buffer_.size()) {
+          fill();
+        }
+        const int32_t value = buffer_[next_++];
+        if (!first && compare_(value, last)) {
+          throw unsorted_exception("the input tape " + std::to_string(index_) + " is not sorted at the element " +
+                                   std::to_string(read_));
+        }
+        ++read_;
+        return value;
+      }
+    };
+
+    /**
+     * <a href="https://en.wikipedia.org/wiki/K-way_merge_algorithm#Tournament_Tree">Loser tree</a>
+     * over the heads of the runs, which are read by the @code sources@endcode.<br>
+     * @code Source@endcode should provide @code bool empty()@endcode and @code int32_t read()@endcode.<br>
+     * The tree does about @code log2(k)@endcode comparisons per element, where @code k@endcode is the count of
+     * sources. Among the equal elements the one from the source with the least index is popped first.
+     */
+    template <typename Source, typename Compare>
+    class loser_tree {
+    private:
+      Compare compare_;
+      std::vector<Source> sources_;
+      std::vector<int32_t> heads_;
+      std::vector<bool> alive_;
+
+      /**
+       * @code losers_[0]@endcode is the index of the winner source.
+       * @code losers_[i]@endcode is the index of the source, which lost the match in the i-th node.
+       * The children of the i-th node are @code 2i@endcode and @code 2i + 1@endcode,
+       * the i-th source is the @code (k + i)@endcode-th node.
+       */
+      std::vector<size_t> losers_;
+
+      /**
+       * Check if the head of the source @code l@endcode should be popped before the head of the source @code r@endcode.
+       */
+      [[nodiscard]] bool beats(const size_t l, const size_t r) const {
+        if (!alive_[r]) {
+          return true;
+        }
+        if (!alive_[l]) {
+          return false;
+        }
+        return l < r ? !compare_(heads_[r], heads_[l]) : compare_(heads_[l], heads_[r]);
+      }
+
+      /**
+       * Read the next head of the @code i@endcode-th source.
+       * @throws io_exception if reading fails
+       */
+      void advance(const size_t i) {
+        if (sources_[i].empty()) {
+          alive_[i] = false;
+        } else {
+          heads_[i] = sources_[i].read();
+        }
+      }
+
+    public:
+      /**
+       * Create the tree and read the first element of each source.
+       * @throws io_exception if reading fails
+       */
+      loser_tree(std::vector<Source> sources, Compare compare)
+          : compare_(compare),
+            sources_(std::move(sources)),
+            heads_(sources_.size()),
+            alive_(sources_.size(), true),
+            losers_(std::max<size_t>(sources_.size(), 1), 0) {
+        const size_t k = sources_.size();
+        for (size_t i = 0; i < k; ++i) {
+          advance(i);
+        }
+        if (k == 0) {
+          return;
+        }
+
+        std::vector<size_t> winners(2 * k);
+        for (size_t i = 0; i < k; ++i) {
+          winners[k + i] = i;
+        }
+        for (size_t node = k; node-- > 1;) {
+          const size_t l = winners[2 * node];
+          const size_t r = winners[2 * node + 1];
+          const bool left_wins = beats(l, r);
+          winners[node] = left_wins ? l : r;
+          losers_[node] = left_wins ? r : l;
+        }
+        losers_[0] = winners[1];
+      }
+
+      /**
+       * @return @code true@endcode if all the elements of all the sources are popped.
+       */
+      [[nodiscard]] bool empty() const {
+        return sources_.empty() || !alive_[losers_[0]];
+      }
+
+      /**
+       * @return the least of the heads.
+       */
+      [[nodiscard]] int32_t top() const {
+        assert(!empty());
+        return heads_[losers_[0]];
+      }
+
+      /**
+       * Pop the least of the heads and read the next element of its source.
+       * @return the popped element
+       * @throws io_exception if reading fails
+       */
+      int32_t pop() {
+        assert(!empty());
+        size_t winner = losers_[0];
+        const int32_t value = heads_[winner];
+        advance(winner);
+
+        const size_t k = sources_.size();
+        for (size_t node = (k + winner) / 2; node > 0; node /= 2) {
+          if (beats(losers_[node], winner)) {
+            std::swap(losers_[node], winner);
+          }
+        }
+        losers_[0] = winner;
+        return value;
+      }
+    };
+
+    /**
+     * Merge the runs read by @code sources@endcode with the @code loser_tree@endcode
+     * and @code put()@endcode the result in @code out@endcode.<br>
+     * Each run should be read in the order defined by @code compare@endcode.
+     * The result is put in the same order.<br>
+     * @code out@endcode head is after the last elements put after the call.
+     *
+     * @return count of the elements put
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TOut, typename Source, typename Compare>
+      requires(tape<TOut>::WRITABLE)
+    size_t merge_runs(std::vector<Source> sources, tape<TOut>& out, Compare compare) {
+      loser_tree tree(std::move(sources), compare);
+      size_t count = 0;
+      for (; !tree.empty(); ++count) {
+        put(out, tree.pop());
+      }
+      return count;
+    }
+  } // namespace helpers
+
+  /**
+   * Merge the sorted data of the @code ins@endcode tapes and put the result to @code out@endcode in the sorted order
+   * in a single pass.<br>
+   * The heads of the inputs are merged by the @code helpers::loser_tree@endcode, and each input is read sequentially
+   * in blocks by the @code helpers::sorted_reader@endcode, which checks that the input is sorted.
+   * Among the equal elements the ones from the inputs with the least index are put first, so the merge is stable.<br>
+   * @code ins@endcode heads are moved back to the beginning of the data after the call.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * blocks, but at least one element for each input.
+   *
+   * @param ins tapes with the sorted elements. Can be read-only. The heads should be at the beginning of the data.
+   * The data lasts till the end of the tape
+   * @param out tape to write the merged elements. Can be write-only.
+   * The head should be at the first position to write
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @return count of the elements put
+   * @throws unsorted_exception if some of the inputs is not sorted. Some of the merged elements can be put,
+   * and the @code ins@endcode heads are moved back to the beginning of the data
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename T, typename TOut, typename Compare = std::less<int32_t>>
+    requires(tape<T>::READABLE && tape<TOut>::WRITABLE)
+  size_t merge(std::span<tape<T>> ins, tape<TOut>& out, const size_t chunk_size = 0, Compare compare = Compare()) {
+    const size_t buffer_size = chunk_size / std::max<size_t>(ins.size(), 1);
+    std::vector<size_t> counts(ins.size());
+    std::vector<helpers::sorted_reader<T, Compare>> sources;
+    for (size_t i = 0; i < ins.size(); ++i) {
+      sources.emplace_back(ins[i], i, buffer_size, compare, counts[i]);
+    }
+
+    auto rewind = [&] {
+      for (size_t i = 0; i < ins.size(); ++i) {
+        ins[i].seek(-counts[i]);
+      }
+    };
+    size_t size;
+    try {
+      size = helpers::merge_runs(std::move(sources), out, compare);
+    } catch (...) {
+      rewind();
+      throw;
+    }
+    rewind();
+    return size;
+  }
+} // namespace tape
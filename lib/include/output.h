@@ -0,0 +1,45 @@
+#pragma once
+#include "tape.h"
+
+#include <cstdint>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * Write the value and move the head forward.
+     * @throws io_exception if writing fails
+     */
+    template <typename T>
+      requires(tape<T>::WRITABLE)
+    void put(tape<T>& current, const int32_t value) {
+      current.set(value);
+      current.next();
+    }
+
+    /**
+     * Outputs of the sorted elements: the writable tapes and the other classes, for which @code put()@endcode is
+     * overloaded.
+     */
+    template <typename Out>
+    concept output = requires(Out& out, const int32_t value) { put(out, value); };
+
+    /**
+     * @code put()@endcode @code count@endcode copies of the @code value@endcode in @code out@endcode.
+     * @throws io_exception if writing fails
+     */
+    template <typename Out>
+      requires(output<Out>)
+    void put_copies(Out& out, const int32_t value, const size_t count) {
+      for (size_t i = 0; i < count; ++i) {
+        put(out, value);
+      }
+    }
+
+    /**
+     * @code true@endcode for the outputs, which keep only one of the equivalent elements put one after another.
+     * So the sorts put a single element of the subarray of the equivalent elements instead of reading it.
+     */
+    template <typename Out>
+    constexpr bool DEDUPLICATING = false;
+  } // namespace helpers
+} // namespace tape
@@ -0,0 +1,142 @@
+#pragma once
+#include "sample-sorter.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <bit>
+#include <future>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * The minimum count of the tapes in a tape set of the @code parallel_sort()@endcode:
+     * the tape of the partition, the tape of the sorted partition and 3 temporary tapes to sort it.
+     */
+    constexpr size_t PARALLEL_SET_SIZE = 5;
+
+    /**
+     * Put the @code info.size()@endcode elements of the partition before the @code set[0]@endcode head
+     * to @code out@endcode in the sorted order using the @code sample_sort_impl()@endcode over the
+     * @code set@endcode tapes starting from the third one.<br>
+     * @code set[0]@endcode head is moved to the beginning of the partition after the call.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TOut, typename T, typename Compare>
+      requires(tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+    void sort_partition(tape<TOut>& out, std::span<tape<T>> set, const subarray_info<Compare>& info,
+                        const size_t chunk_size, Compare compare, const size_t threads) {
+      set[0].seek(-info.size());
+      sample_sort_impl(set[0], out, set.subspan(2), info, chunk_size, compare, threads);
+    }
+  } // namespace helpers
+
+  /**
+   * Put elements from @code in@endcode to @code out@endcode in the sorted order, sorting the independent
+   * partitions concurrently on the separate tape sets.<br>
+   * The sample is gathered by reading @code in@endcode, then @code in@endcode is split into
+   * @code bit_floor(sets.size())@endcode partitions by the quantiles of the sample, one partition per tape set.
+   * Each partition is sorted by the @code sample_sort()@endcode in its own thread with the tapes of its set
+   * and an equal share of the @code chunk_size@endcode and the @code threads@endcode (but at least one thread),
+   * so the partitions do not multiply the threads sorting in memory, and the tapes of the different sets,
+   * which can be the files on the different devices, are used at the same time.<br>
+   * The first partition is sorted directly to @code out@endcode, the other ones are sorted to the second tapes of
+   * their sets and copied to @code out@endcode in order after the previous partitions.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * The tapes of @code sets@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * elements (except the samples).<br>
+   * The sort is not stable.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param sets tape sets of at least 5 tapes each. Must be readable and writable.
+   * Each tape should have at least as much space after the head as the size of the sorted data.
+   * The tapes of a set are accessed only by the thread, which sorts its partition
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory, shared by the partitions
+   * @throws std::invalid_argument if no tape sets are given or some of them have less than 5 tapes
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+  void parallel_sort(tape<TIn>& in, tape<TOut>& out, std::span<std::vector<tape<T>>> sets,
+                     const size_t chunk_size = 0, Compare compare = Compare(), const size_t threads = 1) {
+    if (sets.empty()) {
+      throw std::invalid_argument("at least 1 tape set expected");
+    }
+    for (const auto& set : sets) {
+      if (set.size() < helpers::PARALLEL_SET_SIZE) {
+        throw std::invalid_argument("at least 5 tapes in each tape set expected");
+      }
+    }
+
+    helpers::random_generator gen(std::random_device{}());
+    auto info = helpers::sample_info(sets.size(), compare, gen);
+    while (!in.is_end()) {
+      info.update(in.get());
+      in.next();
+    }
+    in.seek(-info.size());
+
+    if (info.size() <= chunk_size || info.equal() || sets.size() == 1) {
+      helpers::sample_sort_impl(in, out, std::span(sets[0]).subspan(2), info, chunk_size, compare, threads);
+      return;
+    }
+
+    const helpers::splitter_tree<Compare> tree(info.quantiles(std::bit_floor(sets.size())), compare);
+    std::vector<helpers::random_generator> gens;
+    for (size_t bucket = 0; bucket < tree.buckets(); ++bucket) {
+      gens.emplace_back(gen());
+    }
+    std::vector<helpers::subarray_info<Compare>> buckets;
+    for (size_t bucket = 0; bucket < tree.buckets(); ++bucket) {
+      buckets.push_back(helpers::sample_info(sets[bucket].size() - 2, compare, gens[bucket]));
+    }
+    std::vector<size_t> splitter_copies(tree.buckets());
+    for (size_t i = 0; i < info.size(); ++i) {
+      const int32_t value = in.get();
+      in.next();
+      const size_t bucket = tree.bucket(value);
+      if (bucket != 0 && value == tree.lower_bound(bucket)) {
+        ++splitter_copies[bucket];
+      } else {
+        helpers::put(sets[bucket][0], value);
+        buckets[bucket].update(value);
+      }
+    }
+    in.seek(-info.size());
+
+    // each partition uses only the tapes of its set, and the first one also the out tape,
+    // which is not accessed by the caller until the partition is sorted
+    const size_t partition_chunk = chunk_size / tree.buckets();
+    const size_t partition_threads = std::max<size_t>(threads / tree.buckets(), 1);
+    std::vector<std::future<void>> workers;
+    workers.push_back(std::async(std::launch::async, [&] {
+      helpers::sort_partition(out, std::span(sets[0]), buckets[0], partition_chunk, compare, partition_threads);
+    }));
+    for (size_t bucket = 1; bucket < tree.buckets(); ++bucket) {
+      workers.push_back(std::async(std::launch::async, [&, bucket] {
+        helpers::sort_partition(sets[bucket][1], std::span(sets[bucket]), buckets[bucket], partition_chunk, compare,
+                                partition_threads);
+      }));
+    }
+
+    workers[0].get();
+    for (size_t bucket = 1; bucket < tree.buckets(); ++bucket) {
+      workers[bucket].get();
+      for (size_t i = 0; i < splitter_copies[bucket]; ++i) {
+        helpers::put(out, tree.lower_bound(bucket));
+      }
+      tape<T>& sorted = sets[bucket][1];
+      sorted.seek(-buckets[bucket].size());
+      helpers::copy(sorted, out, buckets[bucket].size());
+    }
+  }
+} // namespace tape
@@ -0,0 +1,203 @@
+#pragma once
+#include "output.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * The part of the split, which contains the rest of the requested elements.
+     */
+    enum class partial_side { none, left, right };
+
+    /**
+     * Sort the @code vec@endcode partially and @code put()@endcode its @code k@endcode least elements in
+     * @code out@endcode in the sorted order.<br>
+     * The @code vec@endcode and the scratch memory of the @code sort_leaf()@endcode take no more than
+     * @code chunk_size@endcode elements, the @code vec@endcode is sorted with @code threads@endcode threads.
+     * @throws io_exception if writing fails
+     */
+    template <typename Out, typename Compare>
+      requires(output<Out>)
+    void put_least(std::vector<int32_t>& vec, const size_t k, Out& out, const size_t chunk_size, Compare compare,
+                   const size_t threads) {
+      const size_t scratch = chunk_size - std::min(chunk_size, vec.size());
+      std::nth_element(vec.begin(), vec.begin() + k, vec.end(), compare);
+      vec.resize(k);
+      sort_leaf(vec, compare, scratch, threads);
+      vec_to_tape(vec, out);
+    }
+
+    /**
+     * @code peek()@endcode @code info.size()@endcode elements from @code source@endcode and
+     * @code put()@endcode the @code k@endcode least of them in @code out@endcode in the sorted order,
+     * if they can be found without splitting the elements.<br>
+     * Otherwise, split the elements by the median of the sample. If the left part contains all the requested
+     * elements, the right one is dropped by moving the @code right@endcode head back, so it is never read.
+     * Otherwise, the left part is sorted by the @code sort_impl()@endcode over the @code left@endcode,
+     * @code other@endcode and @code right@endcode tapes, and the copies of the key are put.<br>
+     * The @code info@endcode and @code k@endcode are updated to the part, which contains the rest of the requested
+     * elements.
+     *
+     * @return the part, which contains the rest of the requested elements, or @code partial_side::none@endcode if
+     * all of them are put
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename Out, typename TSrc, typename TLeft, typename TRight, typename TOther, typename Compare>
+      requires(output<Out> && tape<TSrc>::READABLE && tape<TLeft>::BIDIRECTIONAL && tape<TRight>::BIDIRECTIONAL &&
+               tape<TOther>::BIDIRECTIONAL)
+    partial_side partial_step(Out& out, tape<TSrc>& source, tape<TLeft>& left, tape<TRight>& right,
+                              tape<TOther>& other, subarray_info<Compare>& info, size_t& k, const size_t chunk_size,
+                              Compare compare, const size_t threads) {
+      const size_t size = info.size();
+      if (k == 0) {
+        source.seek(-size);
+        return partial_side::none;
+      }
+      if (info.equal()) {
+        for (size_t i = 0; i < k; ++i) {
+          put(out, peek(source));
+        }
+        source.seek(-(size - k));
+        return partial_side::none;
+      }
+      if (size <= chunk_size) {
+        auto vec = tape_to_vec(source, size);
+        put_least(vec, k, out, chunk_size, compare, threads);
+        return partial_side::none;
+      }
+
+      const int32_t key = info.median();
+      std::vector<int32_t> buffer;
+      auto [left_info, equal, right_info] =
+          split<>(source, left, right, compare, key, size, info.generator(), buffer, chunk_size);
+      const bool in_buffer = left_info.size() == buffer.size();
+      if (k <= left_info.size()) {
+        right.seek(-right_info.size());
+        if (in_buffer) {
+          put_least(buffer, k, out, chunk_size, compare, threads);
+          return partial_side::none;
+        }
+        info = std::move(left_info);
+        return partial_side::left;
+      }
+
+      if (in_buffer) {
+        flush_sorted(buffer, out, chunk_size, compare, threads);
+      } else {
+        sort_impl(out, left, other, right, left_info, chunk_size, compare, threads);
+      }
+      k -= left_info.size();
+      const size_t copies = std::min(k, equal);
+      put_copies(out, key, copies);
+      k -= copies;
+      info = std::move(right_info);
+      return partial_side::right;
+    }
+
+    /**
+     * @code put()@endcode the @code k@endcode least of the @code info.size()@endcode elements before the head of the
+     * @code current@endcode-th of the temporary tapes in @code out@endcode in the sorted order
+     * by the @code partial_step()@endcode, which descends only into the part with the requested elements.<br>
+     * The temporary tapes data before the head and the head position are not changed after the call.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename Out, typename T1, typename T2, typename T3, typename Compare>
+      requires(output<Out> && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+    void partial_sort_impl(Out& out, tape<T1>& tmp1, tape<T2>& tmp2, tape<T3>& tmp3, size_t current,
+                           subarray_info<Compare> info, size_t k, const size_t chunk_size, Compare compare,
+                           const size_t threads) {
+      std::tuple<tape<T1>&, tape<T2>&, tape<T3>&> tapes(tmp1, tmp2, tmp3);
+      auto side = partial_side::left;
+      while (side != partial_side::none) {
+        const size_t left = (current + 1) % 3;
+        const size_t right = (current + 2) % 3;
+        visit_tape(tapes, current, [&](auto& src) {
+          visit_tape(tapes, left, [&](auto& l) {
+            visit_tape(tapes, right, [&](auto& r) {
+              side = partial_step(out, src, l, r, src, info, k, chunk_size, compare, threads);
+            });
+          });
+        });
+        current = side == partial_side::left ? left : right;
+      }
+    }
+  } // namespace helpers
+
+  /**
+   * Put the @code k@endcode least elements from @code in@endcode to @code out@endcode in the sorted order.
+   * If @code in@endcode has less than @code k@endcode elements, all of them are put.<br>
+   * If @code k <= chunk_size@endcode, the elements are selected with the heap of @code k@endcode elements in a single
+   * pass, and the temporary tapes are not used. Otherwise, the elements are split as by the quick sort, but only the
+   * part, which contains the rank @code k@endcode, is split further. The parts of the less elements are sorted, and
+   * the parts of the greater ones are dropped without reading, so the most of the data is not read after the first
+   * split.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmp1@endcode, @code tmp2@endcode and @code tmp3@endcode data before the head and the head position are not
+   * changed after the call. The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory.<br>
+   * The sort is not stable.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param k count of the elements to put
+   * @param tmp1 temporary tape. Must be readable and writable.
+   * Should have at least as much space after the head as the size of the sorted data
+   * @param tmp2 temporary tape. Must be readable and writable
+   * Should have at least as much space after the head as the size of the sorted data
+   * @param tmp3 temporary tape. Must be readable and writable
+   * Should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T1, typename T2, typename T3, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL &&
+             tape<T3>::BIDIRECTIONAL)
+  void partial_sort(tape<TIn>& in, tape<TOut>& out, size_t k, tape<T1>& tmp1, tape<T2>& tmp2, tape<T3>& tmp3,
+                    const size_t chunk_size = 0, Compare compare = Compare(), const size_t threads = 1) {
+    if (k <= chunk_size) {
+      // the greatest of the selected elements is on the top of the heap
+      std::vector<int32_t> heap;
+      heap.reserve(k);
+      size_t size = 0;
+      for (; !in.is_end(); ++size) {
+        const int32_t value = in.get();
+        in.next();
+        if (heap.size() < k) {
+          heap.push_back(value);
+          std::push_heap(heap.begin(), heap.end(), compare);
+        } else if (k != 0 && compare(value, heap.front())) {
+          std::pop_heap(heap.begin(), heap.end(), compare);
+          heap.back() = value;
+          std::push_heap(heap.begin(), heap.end(), compare);
+        }
+      }
+      in.seek(-size);
+
+      helpers::sort_leaf(heap, compare, chunk_size - heap.size(), threads);
+      helpers::vec_to_tape(heap, out);
+      return;
+    }
+
+    helpers::random_generator gen(std::random_device{}());
+    helpers::subarray_info<Compare> info(compare, gen);
+    while (!in.is_end()) {
+      info.update(in.get());
+      in.next();
+    }
+    k = std::min(k, info.size());
+
+    const auto side = helpers::partial_step(out, in, tmp1, tmp2, tmp3, info, k, chunk_size, compare, threads);
+    if (side != helpers::partial_side::none) {
+      helpers::partial_sort_impl(out, tmp1, tmp2, tmp3, side == helpers::partial_side::left ? 0 : 1, info, k,
+                                 chunk_size, compare, threads);
+    }
+  }
+} // namespace tape
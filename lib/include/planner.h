@@ -0,0 +1,436 @@
+#pragma once
+#include "radix-key.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace tape {
+  /**
+   * Strategy of sorting the data.
+   */
+  enum class strategy {
+    /**
+     * The data is sorted already, so it is copied.
+     */
+    copy,
+
+    /**
+     * The data is sorted in the reversed order, so it is copied backward.
+     */
+    reverse,
+
+    /**
+     * There are few distinct elements, so they are counted in memory.
+     */
+    counting,
+
+    /**
+     * The data fits in memory.
+     */
+    memory,
+
+    /**
+     * The data consists of few runs, so the runs are merged by the polyphase merge.
+     */
+    merge,
+
+    /**
+     * The comparator is radix-compatible, so the elements are distributed by the digits of the keys.
+     */
+    radix,
+
+    /**
+     * The quick sort on tapes, or the sample sort if the temporary tapes are given as a set.
+     */
+    quick
+  };
+
+  namespace helpers {
+    /**
+     * Statistics of the presortedness of the data, which are gathered in a single pass.
+     */
+    template <typename Compare>
+    class presortedness {
+    private:
+      /**
+       * Ordering, which is defined by the comparator and the values for the elements, which are equal by the
+       * comparator. So different elements are never equal.
+       */
+      class value_order {
+      private:
+        Compare compare_;
+
+      public:
+        explicit value_order(Compare compare) : compare_(compare) {}
+
+        bool operator()(const int32_t l, const int32_t r) const {
+          return compare_(l, r) || (!compare_(r, l) && l < r);
+        }
+      };
+
+      Compare compare_;
+      size_t size_ = 0;
+      size_t runs_ = 0;
+      size_t run_size_ = 0;
+      bool run_descending_ = false;
+      size_t ascents_ = 0;
+      size_t descents_ = 0;
+      int32_t min_ = 0;
+      int32_t max_ = 0;
+      int32_t last_ = 0;
+
+      /**
+       * The counts of the distinct elements. The first @code sorted_@endcode of them are sorted by the
+       * @code value_order@endcode and distinct, the rest are appended by the @code update()@endcode and merged by the
+       * @code consolidate()@endcode.
+       */
+      mutable std::vector<std::pair<int32_t, uint32_t>> counts_;
+      mutable size_t sorted_ = 0;
+      size_t counts_limit_;
+      size_t counted_size_ = 0;
+
+      /**
+       * Sort the counts and merge the counts of the same elements.<br>
+       * The appended elements are not among the sorted ones, so their merged counts do not exceed the limit.
+       */
+      void consolidate() const {
+        if (sorted_ == counts_.size()) {
+          return;
+        }
+        std::sort(counts_.begin(), counts_.end(),
+                  [order = value_order(compare_)](const auto& l, const auto& r) { return order(l.first, r.first); });
+        size_t last = 0;
+        for (size_t i = 1; i < counts_.size(); ++i) {
+          if (counts_[i].first == counts_[last].first) {
+            counts_[last].second += counts_[i].second;
+          } else {
+            counts_[++last] = counts_[i];
+          }
+        }
+        counts_.resize(last + 1);
+        sorted_ = counts_.size();
+      }
+
+      /**
+       * Count the @code value@endcode.
+       * @return @code false@endcode if the counts do not fit in the limit
+       */
+      bool count(const int32_t value) {
+        const value_order order(compare_);
+        const auto end = counts_.begin() + static_cast<ptrdiff_t>(sorted_);
+        const auto it = std::lower_bound(counts_.begin(), end, value,
+                                         [&order](const auto& l, const int32_t r) { return order(l.first, r); });
+        if (it != end && it->first == value) {
+          return it->second++ != std::numeric_limits<uint32_t>::max();
+        }
+        if (counts_.size() == counts_.capacity()) {
+          // the counts are merged before the growth, and dropped if the distinct ones take more than a half of
+          // the limit, so the merges are amortized by at least counts_limit / 2 appended elements
+          consolidate();
+          if (counts_.size() * 2 > counts_limit_) {
+            return false;
+          }
+          if (counts_.size() == counts_.capacity()) {
+            if (counts_.capacity() >= counts_limit_) {
+              return false;
+            }
+            counts_.reserve(std::min(counts_limit_, std::max<size_t>(counts_.capacity() * 2, 16)));
+          }
+        }
+        counts_.emplace_back(value, 1);
+        return true;
+      }
+
+    public:
+      /**
+       * @param compare comparator which defines the ordering
+       * @param counts_limit the maximum count of the counted distinct elements, each of which takes
+       * @code sizeof(int32_t) + sizeof(uint32_t)@endcode bytes. The elements are counted if there are no more than
+       * @code counts_limit / 2@endcode distinct ones, and maybe if there are up to @code counts_limit@endcode of them
+       */
+      presortedness(Compare compare, const size_t counts_limit)
+          : compare_(compare),
+            counts_limit_(std::min<size_t>(counts_limit, std::numeric_limits<uint32_t>::max())) {}
+
+      /**
+       * Update the statistics with the next element of the data.
+       */
+      void update(const int32_t value) {
+        if (size_ == 0) {
+          min_ = max_ = value;
+          runs_ = run_size_ = 1;
+        } else {
+          const bool less = compare_(value, last_);
+          const bool greater = compare_(last_, value);
+          descents_ += less;
+          ascents_ += greater;
+          if (compare_(value, min_)) {
+            min_ = value;
+          }
+          if (compare_(max_, value)) {
+            max_ = value;
+          }
+
+          // the runs are the same as the natural_sort() finds
+          if (run_size_ == 1) {
+            run_descending_ = less;
+            ++run_size_;
+          } else if (run_descending_ ? less : !less) {
+            ++run_size_;
+          } else {
+            ++runs_;
+            run_size_ = 1;
+          }
+        }
+
+        if (counted_size_ == size_) {
+          if (count(value)) {
+            ++counted_size_;
+          } else {
+            counts_.clear();
+            counts_.shrink_to_fit();
+            sorted_ = 0;
+          }
+        }
+
+        last_ = value;
+        ++size_;
+      }
+
+      /**
+       * @return size of the data.
+       */
+      [[nodiscard]] size_t size() const {
+        return size_;
+      }
+
+      /**
+       * @return count of the ascending and strictly descending runs of the data.
+       */
+      [[nodiscard]] size_t runs() const {
+        return runs_;
+      }
+
+      /**
+       * @return count of the adjacent inversions, the lower bound of the count of the inversions.
+       */
+      [[nodiscard]] size_t descents() const {
+        return descents_;
+      }
+
+      /**
+       * @return @code true@endcode if the data is sorted.
+       */
+      [[nodiscard]] bool sorted() const {
+        return descents_ == 0;
+      }
+
+      /**
+       * @return @code true@endcode if the data is sorted in the reversed order.
+       */
+      [[nodiscard]] bool reverse_sorted() const {
+        return ascents_ == 0;
+      }
+
+      /**
+       * @return the least element of the data. The data should not be empty.
+       */
+      [[nodiscard]] int32_t min() const {
+        return min_;
+      }
+
+      /**
+       * @return the greatest element of the data. The data should not be empty.
+       */
+      [[nodiscard]] int32_t max() const {
+        return max_;
+      }
+
+      /**
+       * @return @code true@endcode if the distinct elements fit in the limit, so all the elements are counted.
+       */
+      [[nodiscard]] bool counted() const {
+        return counted_size_ == size_;
+      }
+
+      /**
+       * @return the counts of the distinct elements in the sorted order. Empty if not @code counted()@endcode.
+       */
+      [[nodiscard]] const std::vector<std::pair<int32_t, uint32_t>>& counts() const {
+        consolidate();
+        return counts_;
+      }
+
+      /**
+       * @return estimated share of the elements, which are equal to some previous one.
+       * Exact if @code counted()@endcode.
+       */
+      [[nodiscard]] double duplicates() const {
+        if (size_ == 0) {
+          return 0;
+        }
+        if (counted()) {
+          return 1 - static_cast<double>(counts().size()) / size_;
+        }
+        return 1 - static_cast<double>(counts_limit_ + 1) / (counted_size_ + 1);
+      }
+    };
+  } // namespace helpers
+
+  /**
+   * Estimated counts of the tape operations of a sort, which are priced by the @code delay_config@endcode.
+   */
+  class operation_counts {
+  public:
+    double reads = 0;
+    double writes = 0;
+
+    /**
+     * Count of the moves of the heads to the next or previous position.
+     */
+    double moves = 0;
+    double rewinds = 0;
+
+    /**
+     * Total width of the rewinds.
+     */
+    double rewind_steps = 0;
+
+    /**
+     * Add @code passes@endcode passes, each of which reads and writes @code size@endcode elements moving the heads.
+     */
+    void add_passes(double passes, double size);
+
+    /**
+     * Add @code count@endcode rewinds of the total width @code steps@endcode.
+     */
+    void add_rewinds(double count, double steps);
+
+    /**
+     * @return the emulated time of the operations in ns.
+     */
+    [[nodiscard]] double time(const delay_config& delays) const;
+  };
+
+  /**
+   * Estimate the operations of the @code sample_sort()@endcode after the first pass over the data.<br>
+   * Each pass splits the data into @code bit_floor(tmps - 1)@endcode buckets, until they fit in memory.
+   * The buckets are @code peek()@endcode-ed, so only the input is rewound.
+   * @param size count of the elements
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param tmps count of the temporary tapes, at least 3
+   */
+  operation_counts estimate_quick(size_t size, size_t chunk_size, size_t tmps);
+
+  /**
+   * Estimate the operations of the @code natural_sort()@endcode after the first pass over the data.<br>
+   * The runs are distributed in a pass, then each pass merges about @code tmps - 1@endcode runs into one.
+   * About a half of the merged runs is read forward, which costs two rewinds by the size of the run.
+   * @param size count of the elements
+   * @param runs count of the runs to merge
+   * @param tmps count of the temporary tapes, at least 3
+   */
+  operation_counts estimate_merge(size_t size, size_t runs, size_t tmps);
+
+  /**
+   * Estimate the operations of the @code radix_sort()@endcode after the first pass over the data.<br>
+   * Each pass distributes the data by @code floor(log2(tmps - 1))@endcode bits of the keys, until the buckets fit
+   * in memory or all the @code key_bits@endcode differing bits are used.
+   * The buckets are @code peek()@endcode-ed, so only the input is rewound.
+   * @param size count of the elements
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param tmps count of the temporary tapes, at least 3
+   * @param key_bits count of the bits of the keys after the common prefix of the least and the greatest key
+   */
+  operation_counts estimate_radix(size_t size, size_t chunk_size, size_t tmps, size_t key_bits);
+
+  /**
+   * Choose the fastest strategy to sort the data with the given statistics.
+   * @param stats statistics of the data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param multitape @code true@endcode if the temporary tapes are given as a set of the tapes of the same type,
+   * so the @code strategy::merge@endcode and @code strategy::radix@endcode can be used
+   */
+  template <typename Compare>
+  strategy choose_strategy(const helpers::presortedness<Compare>& stats, const size_t chunk_size,
+                           const bool multitape) {
+    if (stats.sorted()) {
+      return strategy::copy;
+    }
+    if (stats.reverse_sorted()) {
+      return strategy::reverse;
+    }
+    if (stats.counted()) {
+      return strategy::counting;
+    }
+    if (stats.size() <= chunk_size) {
+      return strategy::memory;
+    }
+    // the merge is cheaper if the runs are not shorter than the ones the quick sort could sort in memory
+    if (multitape && stats.runs() * std::max<size_t>(chunk_size, 1) <= stats.size()) {
+      return strategy::merge;
+    }
+    // the radix sort does not depend on the pivot luck and skips the bits, which are common for all the keys
+    if (multitape && radix_compatible<Compare>) {
+      return strategy::radix;
+    }
+    return strategy::quick;
+  }
+
+  /**
+   * Choose the fastest strategy to sort the data with the given statistics on the set of @code tmps@endcode
+   * temporary tapes with the given @code delays@endcode.<br>
+   * The cheap strategies are chosen as by the @code choose_strategy()@endcode without the delays. Otherwise, the
+   * emulated time of the merge, the radix sort (if the comparator is @code radix_compatible@endcode) and the sample
+   * sort is estimated by their @code operation_counts@endcode, and the cheapest one is chosen. So the merge, which
+   * rewinds the runs, loses on the tapes with the slow rewinds. The strategy chosen without the delays is kept
+   * unless another one is strictly cheaper, in particular if the delays are not emulated.
+   * @param stats statistics of the data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param tmps count of the temporary tapes, at least 3
+   * @param delays delays of the temporary tapes
+   */
+  template <typename Compare>
+  strategy choose_strategy(const helpers::presortedness<Compare>& stats, const size_t chunk_size, const size_t tmps,
+                           const delay_config& delays) {
+    const strategy chosen = choose_strategy(stats, chunk_size, true);
+    if (chosen != strategy::merge && chosen != strategy::radix && chosen != strategy::quick) {
+      return chosen;
+    }
+
+    const size_t size = stats.size();
+    const size_t chunk = std::max<size_t>(chunk_size, 1);
+    // the natural sort sorts the blocks of the chunk_size elements, so there are no more runs than the blocks
+    const size_t runs = std::min(stats.runs(), (size + chunk - 1) / chunk);
+    auto time = [&](const strategy candidate) {
+      switch (candidate) {
+      case strategy::merge:
+        return estimate_merge(size, runs, tmps).time(delays);
+      case strategy::radix:
+        if constexpr (radix_compatible<Compare>) {
+          const auto key = radix_key<Compare>::key;
+          const auto key_bits = static_cast<size_t>(std::bit_width(key(stats.min()) ^ key(stats.max())));
+          return estimate_radix(size, chunk_size, tmps, key_bits).time(delays);
+        }
+        return std::numeric_limits<double>::infinity();
+      default:
+        return estimate_quick(size, chunk_size, tmps).time(delays);
+      }
+    };
+
+    strategy best = chosen;
+    double best_time = time(chosen);
+    for (const strategy candidate : {strategy::merge, strategy::radix, strategy::quick}) {
+      if (const double candidate_time = time(candidate); candidate_time < best_time) {
+        best = candidate;
+        best_time = candidate_time;
+      }
+    }
+    return best;
+  }
+} // namespace tape
@@ -0,0 +1,393 @@
+#pragma once
+#include "merger.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * Index of the tape, which means the output tape in @code polyphase_merge()@endcode.
+     */
+    constexpr size_t OUTPUT_TAPE = std::numeric_limits<size_t>::max();
+
+    /**
+     * Run lying on a temporary tape.
+     */
+    class run {
+    public:
+      /**
+       * Count of the elements of the run.
+       */
+      size_t size = 0;
+
+      /**
+       * Indicates if the elements were put in the reversed order. So the run is @code peek()@endcode-ed
+       * in the order defined by the comparator.
+       */
+      bool descending = false;
+    };
+
+    /**
+     * Count of runs on each of @code inputs@endcode tapes in the perfect polyphase distribution
+     * of the smallest level, which contains at least @code runs@endcode runs.<br>
+     * The counts are the generalized Fibonacci numbers of order @code inputs@endcode.
+     */
+    std::vector<size_t> polyphase_distribution(size_t inputs, size_t runs);
+
+    /**
+     * Distribution of the runs over the temporary tapes for the polyphase merge.
+     */
+    class polyphase_plan {
+    public:
+      /**
+       * Index of the tape for each run in the order the runs are formed.
+       */
+      std::vector<size_t> tapes;
+
+      /**
+       * Indicates if the run should be put in the reversed order for each run in the order the runs are formed.<br>
+       * Each merge reverses the order of the runs, so the order is defined by the parity of the merges count
+       * the run takes part in. Thus, the final merge gets the runs in the sorted order and no run is read twice.
+       */
+      std::vector<bool> descending;
+
+      /**
+       * Count of the empty runs put on the top of each tape after the real ones.
+       */
+      std::vector<size_t> dummies;
+
+      /**
+       * Create the plan of distributing @code runs@endcode runs over @code tape_count@endcode tapes.
+       * The last tape is left empty.
+       * @throws std::invalid_argument if @code tape_count < 3@endcode
+       */
+      polyphase_plan(size_t tape_count, size_t runs);
+    };
+
+    /**
+     * Online distribution of the runs over the tapes for the polyphase merge
+     * (<a href="https://en.wikipedia.org/wiki/The_Art_of_Computer_Programming">Knuth</a>, 5.4.2, Algorithm D).<br>
+     * The count of runs is not needed to be known in advance. The last tape is left empty.
+     */
+    class polyphase_distributor {
+    private:
+      /**
+       * Count of runs on each tape in the current perfect distribution. The last element is 0.
+       */
+      std::vector<size_t> counts_;
+
+      /**
+       * Count of runs, which are not put yet to each tape to get the current perfect distribution.
+       * The last element is 0.
+       */
+      std::vector<size_t> dummies_;
+
+      size_t tape_ = 0;
+      bool first_ = true;
+
+    public:
+      /**
+       * @param tape_count count of the tapes
+       * @throws std::invalid_argument if @code tape_count < 3@endcode
+       */
+      explicit polyphase_distributor(size_t tape_count);
+
+      /**
+       * @return index of the tape to put the next run to
+       */
+      size_t next();
+
+      /**
+       * @return count of the empty runs to put on the top of each tape to get the perfect distribution
+       */
+      [[nodiscard]] const std::vector<size_t>& dummies() const {
+        return dummies_;
+      }
+    };
+
+    /**
+     * Perform the polyphase merge of the runs from @code stacks@endcode.<br>
+     * Each element of @code stacks@endcode is the stack of runs on some tape, the top run is the last one.
+     * The last tape should be empty and each of the other tapes should contain the count of runs
+     * from the perfect distribution (see @code polyphase_distribution()@endcode).<br>
+     * @code merge(tops, output)@endcode is called for each merge with the runs popped from the tapes
+     * (as the pairs of the tape index and the run) and the index of the tape to put the result to.
+     * The result is pushed to the @code output@endcode stack.
+     * The last merge is called with @code output == OUTPUT_TAPE@endcode.
+     */
+    template <typename Run, typename Merge>
+    void polyphase_merge(std::vector<std::vector<Run>>& stacks, Merge merge) {
+      size_t output = stacks.size() - 1;
+      std::vector<std::pair<size_t, Run>> tops;
+      tops.reserve(stacks.size() - 1);
+
+      while (true) {
+        assert(stacks[output].empty());
+        size_t count = std::numeric_limits<size_t>::max();
+        bool last = true;
+        for (size_t i = 0; i < stacks.size(); ++i) {
+          if (i != output) {
+            count = std::min(count, stacks[i].size());
+            last = last && stacks[i].size() == 1;
+          }
+        }
+        assert(count != 0);
+
+        for (size_t m = 0; m < count; ++m) {
+          tops.clear();
+          for (size_t i = 0; i < stacks.size(); ++i) {
+            if (i != output) {
+              tops.emplace_back(i, stacks[i].back());
+              stacks[i].pop_back();
+            }
+          }
+          if (last) {
+            merge(tops, OUTPUT_TAPE);
+            return;
+          }
+          stacks[output].push_back(merge(tops, output));
+        }
+
+        for (size_t i = 0; i < stacks.size(); ++i) {
+          if (i != output && stacks[i].empty()) {
+            output = i;
+            break;
+          }
+        }
+      }
+    }
+
+    /**
+     * Merge the @code tops@endcode runs from the @code tmps@endcode and put the result
+     * in the @code tmps[output]@endcode.<br>
+     * The result is put in the reversed order if @code descending@endcode.
+     * Each run is @code peek()@endcode-ed if it is put in the order, which is opposite to the order of the result,
+     * and read forward otherwise.
+     * @return the result run
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TOut, typename T, typename Compare>
+      requires(tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+    run merge_tops(const std::vector<std::pair<size_t, run>>& tops, std::span<tape<T>> tmps, tape<TOut>& out,
+                   const bool descending, Compare compare) {
+      std::vector<run_reader<T>> sources;
+      sources.reserve(tops.size());
+      run result{0, descending};
+      for (const auto& [i, r] : tops) {
+        if (r.size != 0) {
+          sources.emplace_back(tmps[i], r.size, r.descending == descending);
+          result.size += r.size;
+        }
+      }
+
+      if (descending) {
+        merge_runs(std::move(sources), out, [&compare](const int32_t l, const int32_t r) { return compare(r, l); });
+      } else {
+        merge_runs(std::move(sources), out, compare);
+      }
+      return result;
+    }
+
+    /**
+     * Merge of the @code polyphase_merge()@endcode over the @code tmps@endcode, which puts the last run to
+     * @code out@endcode.<br>
+     * The order of the result is chosen so that the most of the elements are @code peek()@endcode-ed.
+     * The last run is put in the sorted order.
+     * @return the result run
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TOut, typename T, typename Compare>
+      requires(tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+    run polyphase_step(const std::vector<std::pair<size_t, run>>& tops, std::span<tape<T>> tmps, tape<TOut>& out,
+                       const size_t output, Compare compare) {
+      if (output == OUTPUT_TAPE) {
+        return merge_tops(tops, tmps, out, false, compare);
+      }
+
+      size_t total = 0;
+      size_t descending = 0;
+      for (const auto& [i, r] : tops) {
+        total += r.size;
+        descending += r.descending ? r.size : 0;
+      }
+      return merge_tops(tops, tmps, tmps[output], 2 * descending < total, compare);
+    }
+  } // namespace helpers
+
+  /**
+   * Put elements from @code in@endcode to @code out@endcode in the sorted order
+   * using the <a href="https://en.wikipedia.org/wiki/Polyphase_merge_sort">polyphase merge sort</a>.<br>
+   * The runs of @code chunk_size@endcode elements are sorted in memory and distributed over the temporary tapes
+   * in the generalized Fibonacci distribution. Then the runs are merged until a single run is left,
+   * the last merge puts the elements to @code out@endcode. No redistribution pass is needed.<br>
+   * The size of the data is counted by moving the @code in@endcode head before the sorting, no elements are read.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * elements.<br>
+   * The sort is not stable.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param tmps at least 3 temporary tapes. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
+   * @throws std::invalid_argument if less than 3 temporary tapes are given
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+  void polyphase_sort(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps, const size_t chunk_size = 0,
+                      Compare compare = Compare(), const size_t threads = 1) {
+    if (tmps.size() < 3) {
+      throw std::invalid_argument("at least 3 temporary tapes expected");
+    }
+    const size_t run_size = std::max<size_t>(chunk_size, 1);
+
+    size_t size = 0;
+    while (!in.is_end()) {
+      in.next();
+      ++size;
+    }
+    in.seek(-size);
+
+    std::vector<int32_t> vec;
+    vec.reserve(std::min(size, run_size));
+    if (size <= run_size) {
+      while (!in.is_end()) {
+        vec.push_back(in.get());
+        in.next();
+      }
+      in.seek(-size);
+
+      helpers::sort_leaf(vec, compare, run_size - size, threads);
+      helpers::vec_to_tape(vec, out);
+      return;
+    }
+
+    const size_t runs = (size + run_size - 1) / run_size;
+    const helpers::polyphase_plan plan(tmps.size(), runs);
+
+    std::vector<std::vector<helpers::run>> stacks(tmps.size());
+    for (size_t r = 0; r < runs; ++r) {
+      vec.clear();
+      while (vec.size() < run_size && !in.is_end()) {
+        vec.push_back(in.get());
+        in.next();
+      }
+
+      helpers::sort_leaf(vec, compare, run_size - vec.size(), threads);
+      if (plan.descending[r]) {
+        std::reverse(vec.begin(), vec.end());
+      }
+      helpers::vec_to_tape(vec, tmps[plan.tapes[r]]);
+      stacks[plan.tapes[r]].push_back({vec.size(), plan.descending[r]});
+    }
+    in.seek(-size);
+    for (size_t i = 0; i < tmps.size(); ++i) {
+      stacks[i].resize(stacks[i].size() + plan.dummies[i]);
+    }
+
+    helpers::polyphase_merge(stacks, [&](const std::vector<std::pair<size_t, helpers::run>>& tops,
+                                         const size_t output) {
+      return helpers::polyphase_step(tops, tmps, out, output, compare);
+    });
+  }
+
+  /**
+   * Put elements from @code in@endcode to @code out@endcode in the sorted order
+   * using the natural polyphase merge sort.<br>
+   * The ascending and descending runs of the data are found while the data is distributed over the temporary tapes,
+   * so the sorted or nearly sorted data takes one or two passes. Then the runs are merged as in
+   * @code polyphase_sort()@endcode.<br>
+   * The data is read by the blocks of @code chunk_size@endcode elements, and each block is sorted in memory by the
+   * @code helpers::sort_leaf()@endcode before the runs are found. The sorted block is reversed if its last element
+   * was less than the first one, so the long descending runs are kept. Thus, there are no more runs than the blocks
+   * or the natural runs.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses @code O(r)@endcode bytes of allocated memory, where @code r@endcode is the count of runs,
+   * and no more than @code chunk_size * sizeof(int32_t)@endcode bytes for the elements.<br>
+   * The sort is not stable.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param tmps at least 3 temporary tapes. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
+   * @throws std::invalid_argument if less than 3 temporary tapes are given
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+  void natural_sort(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps, const size_t chunk_size = 0,
+                    Compare compare = Compare(), const size_t threads = 1) {
+    helpers::polyphase_distributor distributor(tmps.size());
+    std::vector<std::vector<helpers::run>> stacks(tmps.size());
+
+    size_t size = 0;
+    size_t current = helpers::OUTPUT_TAPE;
+    int32_t prev = 0;
+    auto distribute = [&](const int32_t value) {
+      bool continues = false;
+      if (current != helpers::OUTPUT_TAPE) {
+        auto& r = stacks[current].back();
+        if (r.size == 1) {
+          r.descending = compare(value, prev);
+          continues = true;
+        } else {
+          continues = r.descending ? compare(value, prev) : !compare(value, prev);
+        }
+      }
+      if (!continues) {
+        current = distributor.next();
+        stacks[current].emplace_back();
+      }
+
+      helpers::put(tmps[current], value);
+      ++stacks[current].back().size;
+      prev = value;
+    };
+
+    std::vector<int32_t> block;
+    while (!in.is_end()) {
+      block.clear();
+      while (!in.is_end() && block.size() < std::max<size_t>(chunk_size, 1)) {
+        block.push_back(in.get());
+        in.next();
+      }
+      size += block.size();
+
+      const bool descending = compare(block.back(), block.front());
+      helpers::sort_leaf(block, compare, std::max<size_t>(chunk_size, 1) - block.size(), threads);
+      if (descending) {
+        std::reverse(block.begin(), block.end());
+      }
+      for (const int32_t value : block) {
+        distribute(value);
+      }
+    }
+    in.seek(-size);
+    for (size_t i = 0; i < tmps.size(); ++i) {
+      stacks[i].resize(stacks[i].size() + distributor.dummies()[i]);
+    }
+
+    helpers::polyphase_merge(stacks, [&](const std::vector<std::pair<size_t, helpers::run>>& tops,
+                                         const size_t output) {
+      return helpers::polyphase_step(tops, tmps, out, output, compare);
+    });
+  }
+} // namespace tape
@@ -0,0 +1,141 @@
+#pragma once
+#include "radix-key.h"
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tape {
+  /**
+   * Projections of the elements to the keys, which are compared with @code <@endcode.
+   */
+  template <typename Proj>
+  concept projection =
+      std::regular_invocable<const Proj&, int32_t> && std::totally_ordered<std::invoke_result_t<const Proj&, int32_t>>;
+
+  /**
+   * Comparator, which orders the elements by their keys given by the projection.<br>
+   * The sorts compute the key of each element once where they can keep it: the pivot key in the splits
+   * and the keys of the elements sorted in memory, which are sorted as (key, element) pairs.
+   * So the expensive keys are not recomputed in each comparison.<br>
+   * If the projection is stateless and its keys are integers of no more than 32 bits, the comparator is
+   * @code radix_compatible@endcode, so the radix sorts are used for it.
+   */
+  template <typename Proj>
+    requires(projection<Proj>)
+  class by_key {
+  private:
+    Proj proj_;
+
+  public:
+    using key_type = std::remove_cvref_t<std::invoke_result_t<const Proj&, int32_t>>;
+
+    explicit by_key(Proj proj = Proj()) : proj_(std::move(proj)) {}
+
+    /**
+     * @return the key of the @code value@endcode.
+     */
+    [[nodiscard]] key_type key(const int32_t value) const {
+      return std::invoke(proj_, value);
+    }
+
+    bool operator()(const int32_t l, const int32_t r) const {
+      return key(l) < key(r);
+    }
+  };
+
+  /**
+   * The keys of the stateless projections to the integers, so their order is kept by the radix sorts.
+   */
+  template <typename Proj>
+    requires(std::is_empty_v<Proj> && std::default_initializable<Proj> &&
+             std::integral<typename by_key<Proj>::key_type> && sizeof(typename by_key<Proj>::key_type) <= 4)
+  class radix_key<by_key<Proj>> {
+  public:
+    static constexpr uint32_t key(const int32_t value) {
+      const auto key = by_key<Proj>().key(value);
+      if constexpr (std::is_signed_v<decltype(key)>) {
+        return static_cast<uint32_t>(static_cast<int32_t>(key)) ^ (uint32_t{1} << 31);
+      } else {
+        return static_cast<uint32_t>(key);
+      }
+    }
+  };
+
+  namespace helpers {
+    template <typename Compare>
+    class is_by_key : public std::false_type {};
+
+    template <typename Proj>
+    class is_by_key<by_key<Proj>> : public std::true_type {};
+  } // namespace helpers
+
+  /**
+   * Comparators, which order the elements by the keys of a projection.
+   */
+  template <typename Compare>
+  concept keyed = helpers::is_by_key<Compare>::value;
+
+  namespace helpers {
+    /**
+     * @return predicate, which is @code true@endcode for the elements ordered before the @code pivot@endcode.
+     */
+    template <typename Compare>
+    auto before(Compare compare, const int32_t pivot) {
+      return [compare, pivot](const int32_t value) { return compare(value, pivot); };
+    }
+
+    /**
+     * @return predicate, which is @code true@endcode for the elements ordered before the @code pivot@endcode.
+     * The key of the @code pivot@endcode is computed once.
+     */
+    template <typename Proj>
+    auto before(const by_key<Proj>& compare, const int32_t pivot) {
+      return [compare, pivot_key = compare.key(pivot)](const int32_t value) { return compare.key(value) < pivot_key; };
+    }
+
+    /**
+     * @return count of the elements, which the (key, element) pairs of the @code size@endcode elements take.
+     */
+    template <typename Compare>
+      requires(keyed<Compare>)
+    constexpr size_t cached_keys_size(const size_t size) {
+      using entry = std::pair<typename Compare::key_type, int32_t>;
+      return size * ((sizeof(entry) + sizeof(int32_t) - 1) / sizeof(int32_t));
+    }
+
+    /**
+     * Sort the elements of the @code data@endcode as the (key, element) pairs, so the key of each element is
+     * computed once.<br>
+     * The pairs are allocated only if they take no more than @code scratch_size@endcode elements.
+     * @param stable @code true@endcode if the order of the elements with the equal keys should be kept
+     * @return @code false@endcode if the pairs do not fit and the @code data@endcode is not sorted
+     */
+    template <typename Proj>
+    bool sort_cached_keys(const std::span<int32_t> data, const by_key<Proj>& compare, const size_t scratch_size,
+                          const bool stable = false) {
+      if (cached_keys_size<by_key<Proj>>(data.size()) > scratch_size) {
+        return false;
+      }
+
+      std::vector<std::pair<typename by_key<Proj>::key_type, int32_t>> entries;
+      entries.reserve(data.size());
+      for (const int32_t value : data) {
+        entries.emplace_back(compare.key(value), value);
+      }
+      const auto by_first = [](const auto& l, const auto& r) { return l.first < r.first; };
+      if (stable) {
+        std::stable_sort(entries.begin(), entries.end(), by_first);
+      } else {
+        std::sort(entries.begin(), entries.end(), by_first);
+      }
+      std::transform(entries.begin(), entries.end(), data.begin(), [](const auto& entry) { return entry.second; });
+      return true;
+    }
+  } // namespace helpers
+} // namespace tape
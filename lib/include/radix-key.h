@@ -0,0 +1,46 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <functional>
+
+namespace tape {
+  /**
+   * Mapping of the elements to the unsigned keys, which are ordered in the same way as the elements are ordered by the
+   * comparator.<br>
+   * Specialize the class with @code static uint32_t key(int32_t)@endcode for a comparator to declare it
+   * radix-compatible.
+   */
+  template <typename Compare>
+  class radix_key {};
+
+  template <>
+  class radix_key<std::less<int32_t>> {
+  public:
+    static constexpr uint32_t key(const int32_t value) {
+      return static_cast<uint32_t>(value) ^ (uint32_t{1} << 31);
+    }
+  };
+
+  template <>
+  class radix_key<std::greater<int32_t>> {
+  public:
+    static constexpr uint32_t key(const int32_t value) {
+      return ~radix_key<std::less<int32_t>>::key(value);
+    }
+  };
+
+  template <>
+  class radix_key<std::less<>> : public radix_key<std::less<int32_t>> {};
+
+  template <>
+  class radix_key<std::greater<>> : public radix_key<std::greater<int32_t>> {};
+
+  /**
+   * Comparators, for which the @code radix_key@endcode is specialized.
+   */
+  template <typename Compare>
+  concept radix_compatible = requires(const int32_t value) {
+    { radix_key<Compare>::key(value) } -> std::same_as<uint32_t>;
+  };
+} // namespace tape
@@ -0,0 +1,155 @@
+#pragma once
+#include "merger.h"
+#include "radix-key.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <bit>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * Information about the keys of some subarray.
+     */
+    class radix_bucket {
+    public:
+      size_t size = 0;
+      uint32_t min = std::numeric_limits<uint32_t>::max();
+      uint32_t max = 0;
+
+      /**
+       * Update the information with the key of the new element of the subarray.
+       */
+      void update(const uint32_t key) {
+        ++size;
+        min = std::min(min, key);
+        max = std::max(max, key);
+      }
+    };
+
+    /**
+     * Read @code info.size@endcode elements with @code source@endcode and
+     * @code put()@endcode them in @code out@endcode in the sorted order.<br>
+     * The elements are distributed over the temporary tapes except @code tmps[current]@endcode by the highest bits,
+     * which differ in @code info.min@endcode and @code info.max@endcode. So each bucket is not wider than
+     * the @code 1 / b@endcode of the keys range, where @code b@endcode is the count of the buckets.
+     * Then the buckets are sorted recursively.<br>
+     * @code tmps@endcode data before the head and the head position are not changed after the call.
+     * The data after the head can be lost.<br>
+     * If @code info.size <= chunk_size@endcode, the sorting is performed in memory.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TOut, typename T, typename Source, typename Compare>
+      requires(tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL && radix_compatible<Compare>)
+    void radix_step(tape<TOut>& out, std::span<tape<T>> tmps, const size_t current, const radix_bucket& info,
+                    const size_t chunk_size, Compare compare, const size_t threads, Source source) {
+      if (info.size == 0) {
+        return;
+      }
+      if (info.min == info.max) {
+        for (size_t i = 0; i < info.size; ++i) {
+          put(out, source.read());
+        }
+        return;
+      }
+      if (info.size <= chunk_size) {
+        std::vector<int32_t> vec;
+        vec.reserve(info.size);
+        for (size_t i = 0; i < info.size; ++i) {
+          vec.push_back(source.read());
+        }
+        sort_leaf(vec, compare, chunk_size - info.size, threads);
+        vec_to_tape(vec, out);
+        return;
+      }
+
+      std::vector<size_t> targets;
+      for (size_t i = 0; i < tmps.size(); ++i) {
+        if (i != current) {
+          targets.push_back(i);
+        }
+      }
+      const int width = std::bit_width(info.min ^ info.max);
+      const int digit_bits = std::min<int>(std::bit_width(targets.size()) - 1, width);
+      const int shift = width - digit_bits;
+      const uint32_t mask = (uint32_t{1} << digit_bits) - 1;
+
+      std::vector<radix_bucket> buckets(size_t{1} << digit_bits);
+      for (size_t i = 0; i < info.size; ++i) {
+        const int32_t value = source.read();
+        const uint32_t key = radix_key<Compare>::key(value);
+        const uint32_t digit = (key >> shift) & mask;
+        put(tmps[targets[digit]], value);
+        buckets[digit].update(key);
+      }
+
+      for (size_t digit = 0; digit < buckets.size(); ++digit) {
+        tape<T>& bucket = tmps[targets[digit]];
+        radix_step(out, tmps, targets[digit], buckets[digit], chunk_size, compare, threads,
+                   run_reader<T>(bucket, buckets[digit].size));
+      }
+    }
+
+    /**
+     * Put @code info.size@endcode elements after the @code in@endcode head to @code out@endcode in the sorted order
+     * using the @code radix_step()@endcode.<br>
+     * @code in@endcode is not changed after the call.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TIn, typename TOut, typename T, typename Compare>
+      requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL && radix_compatible<Compare>)
+    void radix_sort_impl(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps, const radix_bucket& info,
+                         const size_t chunk_size, Compare compare, const size_t threads) {
+      radix_step(out, tmps, tmps.size(), info, chunk_size, compare, threads, input_reader<TIn>(in, info.size));
+      in.seek(-info.size);
+    }
+  } // namespace helpers
+
+  /**
+   * Put elements from @code in@endcode to @code out@endcode in the sorted order
+   * using the <a href="https://en.wikipedia.org/wiki/Radix_sort#Most_significant_digit">MSD radix sort</a>.<br>
+   * The comparator should be @code radix_compatible@endcode. The temporary tapes are used as buckets,
+   * so with @code k@endcode temporary tapes each pass handles @code floor(log2(k - 1))@endcode bits of the keys.
+   * The bits, which are common for all the keys of a bucket, are skipped. Thus, the count of passes does not
+   * exceed the @code ceil(32 / floor(log2(k - 1))) + 1@endcode regardless of the data.<br>
+   * The keys range is found by reading @code in@endcode before the sorting.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * elements.<br>
+   * The sort is not stable.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param tmps at least 3 temporary tapes. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
+   * @throws std::invalid_argument if less than 3 temporary tapes are given
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL && radix_compatible<Compare>)
+  void radix_sort(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps, const size_t chunk_size = 0,
+                  Compare compare = Compare(), const size_t threads = 1) {
+    if (tmps.size() < 3) {
+      throw std::invalid_argument("at least 3 temporary tapes expected");
+    }
+
+    helpers::radix_bucket info;
+    while (!in.is_end()) {
+      info.update(radix_key<Compare>::key(in.get()));
+      in.next();
+    }
+    in.seek(-info.size);
+
+    helpers::radix_sort_impl(in, out, tmps, info, chunk_size, compare, threads);
+  }
+} // namespace tape
@@ -0,0 +1,220 @@
+#pragma once
+#include "merger.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * The count of the sample elements per bucket, which are taken to choose the splitters.
+     */
+    constexpr size_t OVERSAMPLING = 16;
+
+    /**
+     * Classifier of the elements into the buckets, which are separated by the sorted splitters.<br>
+     * The splitters are stored as an implicit binary search tree (in the
+     * <a href="https://en.wikipedia.org/wiki/Binary_heap#Heap_implementation">heap order</a>),
+     * so the classification is @code log2(buckets())@endcode comparisons without data-dependent branches.
+     */
+    template <typename Compare>
+    class splitter_tree {
+    private:
+      Compare compare_;
+      std::vector<int32_t> splitters_;
+      std::vector<int32_t> tree_;
+      int levels_;
+
+      void build(const std::vector<int32_t>& splitters, size_t& next, const size_t node) {
+        if (node >= tree_.size()) {
+          return;
+        }
+        build(splitters, next, 2 * node);
+        tree_[node] = splitters[next++];
+        build(splitters, next, 2 * node + 1);
+      }
+
+    public:
+      /**
+       * @param splitters sorted splitters. The count of them should be @code 2^k - 1@endcode for some @code k@endcode
+       * @param compare comparator which defines the ordering
+       */
+      splitter_tree(const std::vector<int32_t>& splitters, Compare compare)
+          : compare_(compare),
+            splitters_(splitters),
+            tree_(splitters.size() + 1),
+            levels_(std::bit_width(splitters.size())) {
+        size_t next = 0;
+        build(splitters, next, 1);
+      }
+
+      /**
+       * @return count of the buckets.
+       */
+      [[nodiscard]] size_t buckets() const {
+        return tree_.size();
+      }
+
+      /**
+       * @return the splitter, which is the lower bound of the bucket. The bucket should not be the first one.
+       */
+      [[nodiscard]] int32_t lower_bound(const size_t bucket) const {
+        return splitters_[bucket - 1];
+      }
+
+      /**
+       * @return index of the bucket of the value, which is the count of the splitters not greater than the value.
+       */
+      [[nodiscard]] size_t bucket(const int32_t value) const {
+        size_t node = 1;
+        for (int i = 0; i < levels_; ++i) {
+          node = 2 * node + !compare_(value, tree_[node]);
+        }
+        return node - tree_.size();
+      }
+    };
+
+    /**
+     * @return the information about the subarray with the sample, which is large enough to choose the splitters
+     * for the @code sample_step()@endcode over @code tmps@endcode temporary tapes.
+     */
+    template <typename Compare>
+    subarray_info<Compare> sample_info(const size_t tmps, Compare compare, random_generator& gen) {
+      return subarray_info<Compare>(compare, gen, std::bit_floor(tmps) * OVERSAMPLING);
+    }
+
+    /**
+     * Read @code info.size()@endcode elements with @code source@endcode and
+     * @code put()@endcode them in @code out@endcode in the sorted order.<br>
+     * The elements are split over the temporary tapes except @code tmps[current]@endcode
+     * by the splitters, which are @code info.quantiles()@endcode, then the buckets are sorted recursively.
+     * The copies of the splitters are only counted, and put in @code out@endcode before the buckets they bound,
+     * so the frequent elements, which are likely to be chosen as the splitters, are not written to the tapes.
+     * With @code k@endcode buckets the recursion depth is about @code log_k(info.size() / chunk_size)@endcode.<br>
+     * @code tmps@endcode data before the head and the head position are not changed after the call.
+     * The data after the head can be lost.<br>
+     * If @code info.size() <= chunk_size@endcode, the sorting is performed in memory.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TOut, typename T, typename Source, typename Compare>
+      requires(tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+    void sample_step(tape<TOut>& out, std::span<tape<T>> tmps, const size_t current,
+                     const subarray_info<Compare>& info, const size_t chunk_size, Compare compare, const size_t threads,
+                     Source source) {
+      if (info.size() == 0) {
+        return;
+      }
+      if (info.equal()) {
+        for (size_t i = 0; i < info.size(); ++i) {
+          put(out, source.read());
+        }
+        return;
+      }
+      if (info.size() <= chunk_size) {
+        std::vector<int32_t> vec;
+        vec.reserve(info.size());
+        for (size_t i = 0; i < info.size(); ++i) {
+          vec.push_back(source.read());
+        }
+        sort_leaf(vec, compare, chunk_size - info.size(), threads);
+        vec_to_tape(vec, out);
+        return;
+      }
+
+      std::vector<size_t> targets;
+      for (size_t i = 0; i < tmps.size(); ++i) {
+        if (i != current) {
+          targets.push_back(i);
+        }
+      }
+      const splitter_tree<Compare> tree(info.quantiles(std::bit_floor(targets.size())), compare);
+
+      std::vector buckets(tree.buckets(), sample_info(targets.size(), compare, info.generator()));
+      std::vector<size_t> splitter_copies(tree.buckets());
+      for (size_t i = 0; i < info.size(); ++i) {
+        const int32_t value = source.read();
+        const size_t bucket = tree.bucket(value);
+        if (bucket != 0 && value == tree.lower_bound(bucket)) {
+          ++splitter_copies[bucket];
+        } else {
+          put(tmps[targets[bucket]], value);
+          buckets[bucket].update(value);
+        }
+      }
+
+      for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+        for (size_t i = 0; i < splitter_copies[bucket]; ++i) {
+          put(out, tree.lower_bound(bucket));
+        }
+        tape<T>& tmp = tmps[targets[bucket]];
+        sample_step(out, tmps, targets[bucket], buckets[bucket], chunk_size, compare, threads,
+                    run_reader<T>(tmp, buckets[bucket].size()));
+      }
+    }
+
+    /**
+     * Put @code info.size()@endcode elements after the @code in@endcode head to @code out@endcode in the sorted order
+     * using the @code sample_step()@endcode.<br>
+     * @code in@endcode is not changed after the call.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TIn, typename TOut, typename T, typename Compare>
+      requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+    void sample_sort_impl(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps,
+                          const subarray_info<Compare>& info, const size_t chunk_size, Compare compare,
+                          const size_t threads) {
+      sample_step(out, tmps, tmps.size(), info, chunk_size, compare, threads, input_reader<TIn>(in, info.size()));
+      in.seek(-info.size());
+    }
+  } // namespace helpers
+
+  /**
+   * Put elements from @code in@endcode to @code out@endcode in the sorted order
+   * using the <a href="https://en.wikipedia.org/wiki/Samplesort">sample sort</a>.<br>
+   * With @code k@endcode temporary tapes each pass splits the data into @code bit_floor(k - 1)@endcode buckets
+   * by the splitters, which are the quantiles of a random sample gathered during the previous pass.
+   * So the count of passes is about @code log_{k-1}(size / chunk_size)@endcode instead of
+   * @code log_2(size / chunk_size)@endcode of the quick sort.<br>
+   * The sample is gathered by reading @code in@endcode before the sorting.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * elements (except the samples).<br>
+   * The sort is not stable.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param tmps at least 3 temporary tapes. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
+   * @throws std::invalid_argument if less than 3 temporary tapes are given
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+  void sample_sort(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps, const size_t chunk_size = 0,
+                   Compare compare = Compare(), const size_t threads = 1) {
+    if (tmps.size() < 3) {
+      throw std::invalid_argument("at least 3 temporary tapes expected");
+    }
+
+    helpers::random_generator gen(std::random_device{}());
+    auto info = helpers::sample_info(tmps.size() - 1, compare, gen);
+    while (!in.is_end()) {
+      info.update(in.get());
+      in.next();
+    }
+    in.seek(-info.size());
+
+    helpers::sample_sort_impl(in, out, tmps, info, chunk_size, compare, threads);
+  }
+} // namespace tape
@@ -0,0 +1,543 @@
+#pragma once
+#include "sorter.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * The maximum size of the sample of the subarrays of the selection, which is used to bracket the requested ranks.
+     */
+    constexpr size_t SELECT_SAMPLE_SIZE = 1024;
+
+    /**
+     * The margin of the brackets of the ranks in the sorted sample in the square roots of the sample size.<br>
+     * A rank out of its bracket makes the whole part with the other segments to be read again, so the brackets are
+     * wider than the standard deviation of the position of the rank in the sample.
+     */
+    constexpr double SELECT_MARGIN = 1.5;
+
+    /**
+     * @return the size of the samples of the @code parts@endcode segments of a split, so they share the memory of
+     * @code chunk_size@endcode elements left by the @code held@endcode elements of the other samples, but at least 1.
+     */
+    constexpr size_t select_sample_size(const size_t chunk_size, const size_t held, const size_t parts) {
+      const size_t free = chunk_size - std::min(held, chunk_size);
+      return std::max<size_t>(std::min(SELECT_SAMPLE_SIZE, free / std::max<size_t>(parts, 1)), 1);
+    }
+
+    /**
+     * The mark of the segments of the @code select_task@endcode with no requested ranks.
+     */
+    constexpr size_t NO_GROUP = std::numeric_limits<size_t>::max();
+
+    /**
+     * The elements of a part of the selection between two bounds, which contain some of the requested ranks.
+     */
+    template <typename Compare>
+    class select_group {
+    public:
+      /**
+       * Information about the elements of the group.
+       */
+      subarray_info<Compare> info;
+
+      /**
+       * The requested ranks in the group in the increasing order and the indices of their results.
+       */
+      std::vector<std::pair<size_t, size_t>> ranks;
+    };
+
+    /**
+     * The part to search the requested ranks in by the @code select_impl()@endcode.<br>
+     * The sorted @code bounds@endcode split the elements into the segments: the segment @code i@endcode is between
+     * @code bounds[i - 1]@endcode and @code bounds[i]@endcode, and no element is equivalent to a bound.
+     * The elements of the segment @code i@endcode are the group @code segments[i]@endcode, or are dropped if it is
+     * @code NO_GROUP@endcode.
+     */
+    template <typename Compare>
+    class select_task {
+    public:
+      /**
+       * Index of the tape containing the part.
+       */
+      size_t current;
+
+      /**
+       * Count of the elements of the part on the tape.
+       */
+      size_t size;
+
+      /**
+       * The bounds of the segments in the sorted order.
+       */
+      std::vector<int32_t> bounds;
+
+      /**
+       * Indices of the groups of the segments or @code NO_GROUP@endcode.
+       */
+      std::vector<size_t> segments;
+
+      /**
+       * The groups of the elements with the requested ranks in the order of their segments.
+       */
+      std::vector<select_group<Compare>> groups;
+
+      /**
+       * @return count of the elements of the samples of the groups.
+       */
+      [[nodiscard]] size_t sample_size() const {
+        size_t result = 0;
+        for (const auto& group : groups) {
+          result += group.info.sample().size();
+        }
+        return result;
+      }
+
+      /**
+       * Add the segment after the @code bound@endcode, which is ignored for the first segment, with its
+       * @code group@endcode. The adjacent segments with no group are merged.
+       */
+      void add_segment(const int32_t bound, const size_t group) {
+        if (segments.empty()) {
+          segments.push_back(group);
+        } else if (group != NO_GROUP || segments.back() != NO_GROUP) {
+          bounds.push_back(bound);
+          segments.push_back(group);
+        }
+      }
+    };
+
+    /**
+     * Splitters of a group, which bracket all its requested ranks at once.<br>
+     * The sorted @code bounds@endcode split the elements into the segments: the segment @code i@endcode is between
+     * @code bounds[i - 1]@endcode and @code bounds[i]@endcode, and the elements equivalent to the bounds are in none
+     * of them. The @code inner@endcode segments are inside the brackets of the ranks.
+     */
+    class select_splitters {
+    public:
+      std::vector<int32_t> bounds;
+      std::vector<bool> inner;
+    };
+
+    /**
+     * @return the splitters, which bracket each of the @code ranks@endcode by a pair of the sample elements around
+     * the position of the rank in the sorted sample, so the rank is most likely between them. The margin of the
+     * positions is @code SELECT_MARGIN@endcode square roots of the sample size, and the overlapping brackets are split
+     * between the ranks. The bracket of a rank near the edge of the sample is open on that side. If the sample is too
+     * small to close any side, the bracket is the half of the sample with the rank.
+     */
+    template <typename Compare>
+    select_splitters select_bounds(const subarray_info<Compare>& info,
+                                   const std::vector<std::pair<size_t, size_t>>& ranks, Compare compare) {
+      auto sample = info.sample();
+      std::sort(sample.begin(), sample.end(), compare);
+      const auto count = static_cast<ptrdiff_t>(sample.size());
+      const auto margin =
+          std::max<ptrdiff_t>(static_cast<ptrdiff_t>(SELECT_MARGIN * std::sqrt(static_cast<double>(count))), 1);
+
+      // the positions of the brackets in the sample, -1 and count are the open sides
+      std::vector<std::pair<ptrdiff_t, ptrdiff_t>> brackets;
+      ptrdiff_t previous = -1;
+      for (const auto& [rank, index] : ranks) {
+        const auto position = static_cast<ptrdiff_t>(rank * sample.size() / info.size());
+        if (position == previous) {
+          continue;
+        }
+        ptrdiff_t low = position - margin >= 0 ? position - margin : -1;
+        ptrdiff_t high = position + margin < count ? position + margin : count;
+        if (low < 0 && high == count) {
+          if (rank < info.size() / 2) {
+            high = count / 2;
+          } else {
+            low = count / 2;
+          }
+        }
+        // the overlapping brackets are split between the ranks
+        if (!brackets.empty() && brackets.back().second > low) {
+          const ptrdiff_t middle = (previous + position + 1) / 2;
+          brackets.back().second = middle;
+          low = middle;
+        }
+        brackets.emplace_back(low, high);
+        previous = position;
+      }
+
+      std::vector<ptrdiff_t> positions;
+      for (const auto& [low, high] : brackets) {
+        for (const ptrdiff_t bound : {low, high}) {
+          if (bound >= 0 && bound < count) {
+            positions.push_back(bound);
+          }
+        }
+      }
+
+      select_splitters result;
+      std::sort(positions.begin(), positions.end());
+      for (const ptrdiff_t position : positions) {
+        if (result.bounds.empty() || compare(result.bounds.back(), sample[position])) {
+          result.bounds.push_back(sample[position]);
+        }
+      }
+
+      result.inner.resize(result.bounds.size() + 1);
+      const auto segment = [&](const int32_t value) {
+        return static_cast<size_t>(std::upper_bound(result.bounds.begin(), result.bounds.end(), value, compare) -
+                                   result.bounds.begin());
+      };
+      for (const auto& [low, high] : brackets) {
+        const size_t first = low < 0 ? 0 : segment(sample[low]);
+        const size_t last = high == count ? result.bounds.size() : segment(sample[high]) - 1;
+        for (size_t i = first; i <= last && i < result.inner.size(); ++i) {
+          result.inner[i] = true;
+        }
+      }
+      return result;
+    }
+
+    /**
+     * Find the elements of the requested ranks of the @code task.size@endcode elements before the @code source@endcode
+     * head and put them in @code result@endcode.<br>
+     * The ranks of the equal groups are found without reading them. If the other groups fit in memory with the
+     * @code held@endcode elements of the samples of the pending parts, their ranks are found without splitting.
+     * Otherwise, each group is split by its own @code select_bounds()@endcode, and all the groups are split in a single
+     * pass: the elements of the inner segments are put in @code left@endcode, the ones of the other segments are put
+     * in @code right@endcode, and the ones equivalent to the bounds are only counted, so the ranks, which fall on them,
+     * are found. Each segment is sampled, and the segments with the requested ranks become the groups of the parts.
+     * The parts with the groups are added to @code tasks@endcode, so the right one is processed after the left one, and
+     * the parts with no groups are dropped by moving the heads back, so they are never read.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TSrc, typename TLeft, typename TRight, typename Compare>
+      requires(tape<TSrc>::READABLE && tape<TLeft>::BIDIRECTIONAL && tape<TRight>::BIDIRECTIONAL)
+    void select_step(tape<TSrc>& source, tape<TLeft>& left, tape<TRight>& right, select_task<Compare> task,
+                     const size_t left_index, const size_t right_index, std::vector<select_task<Compare>>& tasks,
+                     std::vector<int32_t>& result, const size_t chunk_size, const size_t held, Compare compare) {
+      std::vector<bool> active(task.groups.size());
+      size_t elements = 0;
+      for (size_t g = 0; g < task.groups.size(); ++g) {
+        const auto& [info, ranks] = task.groups[g];
+        if (info.equal()) {
+          for (const auto& [rank, index] : ranks) {
+            result[index] = info.element();
+          }
+        } else {
+          active[g] = true;
+          elements += info.size();
+        }
+      }
+      if (elements == 0) {
+        source.seek(-task.size);
+        return;
+      }
+      const auto group_of = [&](const int32_t value) {
+        const auto segment = std::upper_bound(task.bounds.begin(), task.bounds.end(), value, compare);
+        const size_t g = task.segments[segment - task.bounds.begin()];
+        return g != NO_GROUP && active[g] ? g : NO_GROUP;
+      };
+
+      if (elements + held + task.sample_size() <= chunk_size) {
+        std::vector<std::vector<int32_t>> values(task.groups.size());
+        for (size_t g = 0; g < task.groups.size(); ++g) {
+          if (active[g]) {
+            values[g].reserve(task.groups[g].info.size());
+          }
+        }
+        for (size_t i = 0; i < task.size; ++i) {
+          const int32_t value = peek(source);
+          if (const size_t g = group_of(value); g != NO_GROUP) {
+            values[g].push_back(value);
+          }
+        }
+        for (size_t g = 0; g < task.groups.size(); ++g) {
+          if (!active[g]) {
+            continue;
+          }
+          auto& vec = values[g];
+          auto first = vec.begin();
+          for (const auto& [rank, index] : task.groups[g].ranks) {
+            std::nth_element(first, vec.begin() + rank, vec.end(), compare);
+            first = vec.begin() + rank;
+            result[index] = *first;
+          }
+        }
+        return;
+      }
+
+      // the samples of the groups are dropped once the bounds are chosen, so the samples of the segments take
+      // their memory, and the inner segments, where the ranks most likely are, share it
+      std::vector<select_splitters> splitters(task.groups.size());
+      size_t bounds_size = 0;
+      size_t parts = 0;
+      for (size_t g = 0; g < task.groups.size(); ++g) {
+        if (active[g]) {
+          auto& info = task.groups[g].info;
+          splitters[g] = select_bounds(info, task.groups[g].ranks, compare);
+          info = subarray_info(compare, info.generator(), 1);
+          bounds_size += splitters[g].bounds.size();
+          parts += std::count(splitters[g].inner.begin(), splitters[g].inner.end(), true);
+        }
+      }
+      // the information about the segments of the groups and the counts of the elements equivalent to the bounds
+      const size_t sample_size = select_sample_size(chunk_size, held + bounds_size, parts);
+      std::vector<std::vector<subarray_info<Compare>>> infos(task.groups.size());
+      std::vector<std::vector<size_t>> equal(task.groups.size());
+      for (size_t g = 0; g < task.groups.size(); ++g) {
+        for (size_t i = 0; active[g] && i < splitters[g].inner.size(); ++i) {
+          infos[g].emplace_back(compare, task.groups[g].info.generator(), splitters[g].inner[i] ? sample_size : 1);
+        }
+        equal[g].resize(splitters[g].bounds.size());
+      }
+
+      size_t left_size = 0;
+      size_t right_size = 0;
+      for (size_t i = 0; i < task.size; ++i) {
+        const int32_t value = peek(source);
+        const size_t g = group_of(value);
+        if (g == NO_GROUP) {
+          continue;
+        }
+        const auto& [bounds, inner] = splitters[g];
+        const size_t segment = std::upper_bound(bounds.begin(), bounds.end(), value, compare) - bounds.begin();
+        if (segment > 0 && !compare(bounds[segment - 1], value)) {
+          ++equal[g][segment - 1];
+          continue;
+        }
+        infos[g][segment].update(value);
+        if (inner[segment]) {
+          put(left, value);
+          ++left_size;
+        } else {
+          put(right, value);
+          ++right_size;
+        }
+      }
+
+      select_task<Compare> left_task{left_index, left_size, {}, {}, {}};
+      select_task<Compare> right_task{right_index, right_size, {}, {}, {}};
+      for (size_t s = 0; s < task.segments.size(); ++s) {
+        const int32_t lower = s > 0 ? task.bounds[s - 1] : 0;
+        const size_t g = task.segments[s];
+        if (g == NO_GROUP || !active[g]) {
+          left_task.add_segment(lower, NO_GROUP);
+          right_task.add_segment(lower, NO_GROUP);
+          continue;
+        }
+
+        // the ranks are in the increasing order, so the segments of the group are passed once
+        const auto& [bounds, inner] = splitters[g];
+        const auto& ranks = task.groups[g].ranks;
+        size_t r = 0;
+        size_t first = 0;
+        for (size_t i = 0; i < inner.size(); ++i) {
+          select_group<Compare> group{std::move(infos[g][i]), {}};
+          for (const size_t last = first + group.info.size(); r < ranks.size() && ranks[r].first < last; ++r) {
+            group.ranks.emplace_back(ranks[r].first - first, ranks[r].second);
+          }
+          first += group.info.size();
+          for (; i < bounds.size() && r < ranks.size() && ranks[r].first < first + equal[g][i]; ++r) {
+            result[ranks[r].second] = bounds[i];
+          }
+          first += i < bounds.size() ? equal[g][i] : 0;
+
+          const int32_t bound = i > 0 ? bounds[i - 1] : lower;
+          auto& target = inner[i] ? left_task : right_task;
+          auto& other = inner[i] ? right_task : left_task;
+          other.add_segment(bound, NO_GROUP);
+          if (group.ranks.empty()) {
+            target.add_segment(bound, NO_GROUP);
+          } else {
+            target.add_segment(bound, target.groups.size());
+            target.groups.push_back(std::move(group));
+          }
+        }
+      }
+
+      if (right_task.groups.empty()) {
+        right.seek(-right_size);
+      } else {
+        tasks.push_back(std::move(right_task));
+      }
+      if (left_task.groups.empty()) {
+        left.seek(-left_size);
+      } else {
+        tasks.push_back(std::move(left_task));
+      }
+    }
+
+    /**
+     * Find the elements of the requested @code ranks@endcode of the @code info.size()@endcode elements before the
+     * @code in@endcode head and put them in @code result@endcode.<br>
+     * Each pass over a part splits all its groups by the @code select_step()@endcode, which brackets all the ranks of
+     * a group at once by the splitters chosen from its sample, and only the segments with the requested ranks are
+     * split further. So all the ranks are narrowed by each pass together. The samples of the segments are collected
+     * by the split, which puts them, and they share the memory of @code chunk_size@endcode elements with the samples
+     * of the pending parts. The groups are found in memory once they fit in it.<br>
+     * @code in@endcode head is at the beginning of the data after the call.<br>
+     * @code tmp1@endcode, @code tmp2@endcode and @code tmp3@endcode data before the head and the head position are not
+     * changed after the call. The data after the head can be lost.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename TIn, typename T1, typename T2, typename T3, typename Compare>
+      requires(tape<TIn>::READABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+    void select_impl(tape<TIn>& in, subarray_info<Compare> info, std::vector<std::pair<size_t, size_t>> ranks,
+                     std::vector<int32_t>& result, tape<T1>& tmp1, tape<T2>& tmp2, tape<T3>& tmp3,
+                     const size_t chunk_size, Compare compare) {
+      if (ranks.empty()) {
+        in.seek(-info.size());
+        return;
+      }
+      std::sort(ranks.begin(), ranks.end());
+
+      std::tuple<tape<T1>&, tape<T2>&, tape<T3>&> tapes(tmp1, tmp2, tmp3);
+      std::vector<select_task<Compare>> tasks;
+      const size_t size = info.size();
+      std::vector<select_group<Compare>> groups;
+      groups.push_back({std::move(info), std::move(ranks)});
+      select_step(in, tmp1, tmp2, {0, size, {}, {0}, std::move(groups)}, 0, 1, tasks, result, chunk_size, 0, compare);
+      while (!tasks.empty()) {
+        select_task<Compare> task = std::move(tasks.back());
+        tasks.pop_back();
+        size_t held = 0;
+        for (const auto& pending : tasks) {
+          held += pending.sample_size();
+        }
+
+        const size_t left = (task.current + 1) % 3;
+        const size_t right = (task.current + 2) % 3;
+        visit_tape(tapes, task.current, [&](auto& src) {
+          visit_tape(tapes, left, [&](auto& l) {
+            visit_tape(tapes, right, [&](auto& r) {
+              select_step(src, l, r, std::move(task), left, right, tasks, result, chunk_size, held, compare);
+            });
+          });
+        });
+      }
+    }
+
+    /**
+     * Read the elements from @code in@endcode moving the head forward.
+     * @return the information about the elements with the sample for the selection, which is sized by the
+     * @code select_sample_size()@endcode
+     * @throws io_exception if reading fails
+     */
+    template <typename TIn, typename Compare>
+      requires(tape<TIn>::READABLE)
+    subarray_info<Compare> select_info(tape<TIn>& in, random_generator& gen, const size_t chunk_size,
+                                       Compare compare) {
+      subarray_info<Compare> info(compare, gen, select_sample_size(chunk_size, 0, 1));
+      while (!in.is_end()) {
+        info.update(in.get());
+        in.next();
+      }
+      return info;
+    }
+  } // namespace helpers
+
+  /**
+   * Find the elements of the @code ranks@endcode in the sorted order of the elements from @code in@endcode
+   * without sorting them.<br>
+   * The elements are read once to sample them. Then a pass splits them into the segments by the pairs of the sample
+   * elements, which bracket all the requested ranks at once, and puts the segments inside the brackets and the other
+   * ones on two tapes. Each segment with the requested ranks keeps its own sample, so each next pass over a tape
+   * narrows all its ranks at once, and the count of the ranks does not multiply the passes. The segments with no
+   * requested ranks are dropped, and the tapes with no requested ranks are not read. Once the segments fit in memory,
+   * their ranks are found by @code std::nth_element()@endcode.<br>
+   * The elements of the ranks are equivalent to the ones of the sorted data, but can differ from them, if the
+   * comparator has different equivalent elements.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmp1@endcode, @code tmp2@endcode and @code tmp3@endcode data before the head and the head position are not
+   * changed after the call. The data after the head can be lost.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * elements and the samples, but at least one element for each sample.
+   *
+   * @param in tape with elements. Can be read-only. The head should be at the beginning of the data
+   * @param ranks the 0-based ranks of the elements to find
+   * @param tmp1 temporary tape. Must be readable and writable.
+   * Should have at least as much space after the head as the size of the data
+   * @param tmp2 temporary tape. Must be readable and writable
+   * Should have at least as much space after the head as the size of the data
+   * @param tmp3 temporary tape. Must be readable and writable
+   * Should have at least as much space after the head as the size of the data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @return the elements of the @code ranks@endcode in the order of the @code ranks@endcode
+   * @throws std::out_of_range if some of the ranks is not less than the count of the elements
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename T1, typename T2, typename T3, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+  std::vector<int32_t> select(tape<TIn>& in, const std::span<const size_t> ranks, tape<T1>& tmp1, tape<T2>& tmp2,
+                              tape<T3>& tmp3, const size_t chunk_size = 0, Compare compare = Compare()) {
+    helpers::random_generator gen(std::random_device{}());
+    auto info = helpers::select_info(in, gen, chunk_size, compare);
+
+    std::vector<std::pair<size_t, size_t>> indexed;
+    for (size_t i = 0; i < ranks.size(); ++i) {
+      if (ranks[i] >= info.size()) {
+        in.seek(-info.size());
+        throw std::out_of_range("rank is out of the data");
+      }
+      indexed.emplace_back(ranks[i], i);
+    }
+    std::vector<int32_t> result(ranks.size());
+    helpers::select_impl(in, std::move(info), std::move(indexed), result, tmp1, tmp2, tmp3, chunk_size, compare);
+    return result;
+  }
+
+  /**
+   * @code select()@endcode of the single element of the rank @code n@endcode.
+   */
+  template <typename TIn, typename T1, typename T2, typename T3, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+  int32_t nth_element(tape<TIn>& in, const size_t n, tape<T1>& tmp1, tape<T2>& tmp2, tape<T3>& tmp3,
+                      const size_t chunk_size = 0, Compare compare = Compare()) {
+    return select(in, std::span(&n, 1), tmp1, tmp2, tmp3, chunk_size, compare).front();
+  }
+
+  /**
+   * @code select()@endcode of the quantiles of the elements: the quantile @code q@endcode of @code size@endcode
+   * elements is the element of the rank @code floor(q * (size - 1))@endcode, so the quantile 0.5 is the median
+   * and 0.99 is the 99th percentile.
+   *
+   * @param levels the quantiles to find from @code [0, 1]@endcode
+   * @return the quantiles of the elements in the order of the @code levels@endcode
+   * @throws std::invalid_argument if some of the @code levels@endcode is not from @code [0, 1]@endcode
+   * @throws std::out_of_range if @code levels@endcode are not empty, but @code in@endcode is empty
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename T1, typename T2, typename T3, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+  std::vector<int32_t> quantiles(tape<TIn>& in, const std::span<const double> levels, tape<T1>& tmp1,
+                                 tape<T2>& tmp2, tape<T3>& tmp3, const size_t chunk_size = 0,
+                                 Compare compare = Compare()) {
+    for (const double q : levels) {
+      if (!(q >= 0 && q <= 1)) {
+        throw std::invalid_argument("quantile is out of [0, 1]");
+      }
+    }
+
+    helpers::random_generator gen(std::random_device{}());
+    auto info = helpers::select_info(in, gen, chunk_size, compare);
+    if (info.size() == 0 && !levels.empty()) {
+      throw std::out_of_range("no elements to find quantiles");
+    }
+
+    std::vector<std::pair<size_t, size_t>> ranks;
+    for (size_t i = 0; i < levels.size(); ++i) {
+      const auto rank = static_cast<size_t>(std::floor(levels[i] * static_cast<double>(info.size() - 1)));
+      ranks.emplace_back(std::min(rank, info.size() - 1), i);
+    }
+    std::vector<int32_t> result(levels.size());
+    helpers::select_impl(in, std::move(info), std::move(ranks), result, tmp1, tmp2, tmp3, chunk_size, compare);
+    return result;
+  }
+} // namespace tape
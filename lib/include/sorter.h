@@ -1,12 +1,35 @@
 #pragma once
+#include "leaf-pipeline.h"
+#include "leaf-sort.h"
+#include "output.h"
+#include "planner.h"
+#include "projection.h"
 #include "tape.h"
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <functional>
+#include <limits>
 #include <random>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace tape {
   namespace helpers {
+    /**
+     * The default size of the sample of the @code subarray_info@endcode, which is used to choose the pivot.
+     */
+    constexpr size_t PIVOT_SAMPLE_SIZE = 31;
+
+    /**
+     * Random numbers generator, which is created for each sort and shared by all its @code subarray_info@endcode.
+     */
+    using random_generator = std::mt19937;
+
     /**
      * Class, which contains the information about some subarray.<br>
      */
@@ -14,16 +37,72 @@ namespace tape {
     class subarray_info {
     private:
       Compare compare_;
+      std::reference_wrapper<random_generator> gen_;
       bool equal_ = true;
-      int32_t element_ = 0;
+      std::vector<int32_t> sample_;
+      size_t sample_size_;
       size_t size_ = 0;
+      size_t next_ = 0;
+      double weight_ = 0;
+
+      /**
+       * @return random number from the interval @code (0, 1)@endcode.
+       */
+      double random() {
+        return std::uniform_real_distribution<double>(std::numeric_limits<double>::min(), 1)(gen_.get());
+      }
+
+      /**
+       * Choose the index of the next value to put in the sample and update the weight.
+       * The current value has the index @code size_@endcode.
+       */
+      void skip() {
+        weight_ *= std::exp(std::log(random()) / sample_size_);
+        const double skipped = std::floor(std::log(random()) / std::log1p(-weight_));
+        next_ = skipped < static_cast<double>(std::numeric_limits<size_t>::max() / 2)
+                    ? size_ + static_cast<size_t>(skipped) + 1
+                    : std::numeric_limits<size_t>::max();
+      }
 
     public:
       /**
        * @return some element of the subarray. The elements are uniformly distributed.
        */
       [[nodiscard]] int32_t element() const {
-        return element_;
+        return sample_.front();
+      }
+
+      /**
+       * @return random sample of no more than @code sample_size@endcode elements of the subarray without repetitions.
+       * Each subset of the elements of the sample size is equally likely.
+       */
+      [[nodiscard]] const std::vector<int32_t>& sample() const {
+        return sample_;
+      }
+
+      /**
+       * @return the median of the sample. The subarray should not be empty.
+       */
+      [[nodiscard]] int32_t median() const {
+        auto sample = sample_;
+        const auto middle = sample.begin() + sample.size() / 2;
+        std::nth_element(sample.begin(), middle, sample.end(), compare_);
+        return *middle;
+      }
+
+      /**
+       * @return @code parts - 1@endcode evenly spaced quantiles of the sample in the sorted order.
+       * The subarray should not be empty.
+       */
+      [[nodiscard]] std::vector<int32_t> quantiles(const size_t parts) const {
+        auto sample = sample_;
+        std::sort(sample.begin(), sample.end(), compare_);
+        std::vector<int32_t> result;
+        result.reserve(parts - 1);
+        for (size_t i = 1; i < parts; ++i) {
+          result.push_back(sample[i * sample.size() / parts]);
+        }
+        return result;
       }
 
       /**
@@ -40,25 +119,51 @@ namespace tape {
         return size_;
       }
 
-      explicit subarray_info(Compare compare) : compare_(compare) {}
+      /**
+       * @return the random numbers generator of the sort.
+       */
+      [[nodiscard]] random_generator& generator() const {
+        return gen_;
+      }
+
+      /**
+       * @param compare comparator which defines the ordering
+       * @param gen random numbers generator of the sort
+       * @param sample_size the maximum size of the sample, at least 1
+       */
+      subarray_info(Compare compare, random_generator& gen, const size_t sample_size = PIVOT_SAMPLE_SIZE)
+          : compare_(compare),
+            gen_(gen),
+            sample_size_(std::max<size_t>(sample_size, 1)) {}
 
       /**
        * Update the information with new element of the subarray.<br>
        */
       void update(const int32_t value) {
-        static std::mt19937 gen(std::random_device{}());
-        equal_ = equal_ && (size_ == 0 || !compare_(element_, value) && !compare_(value, element_));
+        equal_ = equal_ && (size_ == 0 || !compare_(sample_.front(), value) && !compare_(value, sample_.front()));
 
         /**
-         * About the probability:
-         * Let it be the i-th call of update() (so the size_ == i - 1).
-         * The element() is updated with the new value with the probability c[i] = 1 / i.
-         * So for each j the element() is equal to the j-th value with probability
-         * p[j] = c[j] * (1 - c[j+1]) * ... * (1 - c[i]) = 1 / i.
-         * Thus after each call of update() the element() is equal to one of the values with the uniform distribution.
+         * About the probability (the reservoir sampling):
+         * While the sample is not full, the new value is put at the random position, so the sample is randomly
+         * ordered and each its position (the element() in particular) is uniformly distributed over the values.
+         * Then the values, which replace a random element of the sample, are chosen by the
+         * <a href="https://en.wikipedia.org/wiki/Reservoir_sampling#Optimal:_Algorithm_L">Algorithm L</a>:
+         * the weight is the greatest of sample_size_ random keys of the sampled values, and the count of the values
+         * to skip until some value gets a smaller key is geometrically distributed.
+         * The result is the same as if each i-th value replaced a random element with the probability
+         * sample_size_ / i, but the random numbers are generated only O(sample_size_ * log(size_ / sample_size_))
+         * times instead of size_ times.
          */
-        if (std::uniform_int_distribution<>(0, size_)(gen) == 0) {
-          element_ = value;
+        if (size_ < sample_size_) {
+          sample_.push_back(value);
+          std::swap(sample_[std::uniform_int_distribution<size_t>(0, size_)(gen_.get())], sample_.back());
+          if (size_ + 1 == sample_size_) {
+            weight_ = 1;
+            skip();
+          }
+        } else if (size_ == next_) {
+          sample_[std::uniform_int_distribution<size_t>(0, sample_size_ - 1)(gen_.get())] = value;
+          skip();
         }
         ++size_;
       }
@@ -75,17 +180,6 @@ namespace tape {
       return current.get();
     }
 
-    /**
-     * Write the value and move the head forward.
-     * @throws io_exception if writing fails
-     */
-    template <typename T>
-      requires(tape<T>::WRITABLE)
-    void put(tape<T>& current, const int32_t value) {
-      current.set(value);
-      current.next();
-    }
-
     /**
      * @code put()@endcode the elements from @code vec@endcode in @code current@endcode.<br>
      * The original ordering of the elements from the vector is saved in the tape.<br>
@@ -93,14 +187,42 @@ namespace tape {
      *
      * @throws io_exception if writing fails
      */
-    template <typename T>
-      requires(tape<T>::WRITABLE)
-    void vec_to_tape(const std::vector<int32_t>& vec, tape<T>& current) {
+    template <typename Out>
+      requires(output<Out>)
+    void vec_to_tape(const std::vector<int32_t>& vec, Out& current) {
       for (const auto v : vec) {
         put(current, v);
       }
     }
 
+    /**
+     * Read @code size@endcode elements from @code source@endcode moving the head forward and
+     * @code put()@endcode them in @code current@endcode.<br>
+     * @code source@endcode head is moved back to the first element read after the call.
+     * @throws io_exception if reading or writing fails
+     */
+    template <typename TSrc, typename Out>
+      requires(tape<TSrc>::READABLE && output<Out>)
+    void copy(tape<TSrc>& source, Out& current, const size_t size) {
+      for (size_t i = 0; i < size; ++i) {
+        put(current, source.get());
+        source.next();
+      }
+      source.seek(-size);
+    }
+
+    /**
+     * @code put()@endcode the elements counted by @code stats@endcode in @code current@endcode in the sorted order.
+     * @throws io_exception if writing fails
+     */
+    template <typename Out, typename Compare>
+      requires(output<Out>)
+    void put_counts(const presortedness<Compare>& stats, Out& current) {
+      for (const auto& [value, count] : stats.counts()) {
+        put_copies(current, value, count);
+      }
+    }
+
     /**
      * @code peek()@endcode up to @code size@endcode elements
      * from the @code current@endcode and put them to @code std::vector@endcode
@@ -122,36 +244,315 @@ namespace tape {
     /**
      * @code peek()@endcode exactly @code size@endcode elements from the @code source@endcode.<br>
      * @code put()@endcode the element in @code left@endcode if @code compare(element, key)@endcode.
+     * For the @code keyed@endcode comparators the key of the @code key@endcode is computed once.
+     * Count the element if it is the same as the @code key@endcode.
      * Otherwise @code put()@endcode the element in @code right@endcode.<br>
+     * So the elements, which are equivalent to the @code key@endcode, but have another value, are put in
+     * @code right@endcode, and the @code key@endcode copies can be put between the sorted @code left@endcode and
+     * @code right@endcode elements with no tape writes.<br>
+     * The elements for @code left@endcode are kept in @code buffer@endcode instead, while @code fits(n)@endcode
+     * allows the buffer of @code n@endcode elements. So if the left part fits in the @code buffer@endcode,
+     * it is not written to the tape.<br>
      * @code left@endcode and @code right@endcode heads are after the last elements put after the call.
      * The original ordering of elements is not saved after the call.<br>
-     * @code source@endcode head is at the leftmost element peeked after the call.
+     * @code source@endcode head is at the leftmost element peeked after the call.<br>
+     * The samples of the returned @code subarray_info@endcode are chosen with @code gen@endcode and have no more than
+     * @code sample_size@endcode elements.
      *
-     * @return @code std::pair@endcode of the @code subarray_info@endcode of the elements
-     * put in @code left@endcode and @code right@endcode
+     * @return @code std::tuple@endcode of the @code subarray_info@endcode of the elements put in @code left@endcode
+     * or kept in @code buffer@endcode, the count of the @code key@endcode copies and the @code subarray_info@endcode
+     * of the elements put in @code right@endcode
      * @throws io_exception if reading or writing to some of the tapes fails
      */
-    template <typename TSrc, typename TLeft, typename TRight, typename Compare>
-      requires(tape<TSrc>::READABLE && tape<TLeft>::WRITABLE && tape<TRight>::WRITABLE)
-    std::pair<subarray_info<Compare>, subarray_info<Compare>> split(tape<TSrc>& source, tape<TLeft>& left,
-                                                                    tape<TRight>& right, Compare compare,
-                                                                    const int32_t key, const size_t size) {
-      subarray_info left_info(compare);
-      subarray_info right_info(compare);
+    template <typename TSrc, typename TLeft, typename TRight, typename Compare, typename Fits>
+      requires(tape<TSrc>::READABLE && tape<TLeft>::WRITABLE && tape<TRight>::WRITABLE &&
+               std::predicate<Fits, size_t>)
+    std::tuple<subarray_info<Compare>, size_t, subarray_info<Compare>> split(tape<TSrc>& source, tape<TLeft>& left,
+                                                                             tape<TRight>& right, Compare compare,
+                                                                             const int32_t key, const size_t size,
+                                                                             random_generator& gen,
+                                                                             std::vector<int32_t>& buffer, Fits fits,
+                                                                             const size_t sample_size =
+                                                                                 PIVOT_SAMPLE_SIZE) {
+      subarray_info left_info(compare, gen, sample_size);
+      subarray_info right_info(compare, gen, sample_size);
+      size_t equal = 0;
+      const auto to_left = before(compare, key);
 
       for (size_t i = 0; i < size; ++i) {
         const int32_t value = helpers::peek(source);
-        if (compare(value, key)) {
-          helpers::put(left, value);
+        if (to_left(value)) {
+          if (buffer.size() == left_info.size() && fits(buffer.size() + 1)) {
+            buffer.push_back(value);
+          } else {
+            if (!buffer.empty()) {
+              vec_to_tape(buffer, left);
+              buffer.clear();
+              buffer.shrink_to_fit();
+            }
+            helpers::put(left, value);
+          }
           left_info.update(value);
+        } else if (value == key) {
+          ++equal;
         } else {
           helpers::put(right, value);
           right_info.update(value);
         }
       }
-      return std::make_pair(left_info, right_info);
+      return std::make_tuple(left_info, equal, right_info);
+    }
+
+    /**
+     * @code split()@endcode with the buffer of no more than @code buffer_size@endcode elements.
+     */
+    template <typename TSrc, typename TLeft, typename TRight, typename Compare>
+      requires(tape<TSrc>::READABLE && tape<TLeft>::WRITABLE && tape<TRight>::WRITABLE)
+    std::tuple<subarray_info<Compare>, size_t, subarray_info<Compare>> split(tape<TSrc>& source, tape<TLeft>& left,
+                                                                             tape<TRight>& right, Compare compare,
+                                                                             const int32_t key, const size_t size,
+                                                                             random_generator& gen,
+                                                                             std::vector<int32_t>& buffer,
+                                                                             const size_t buffer_size) {
+      return split(source, left, right, compare, key, size, gen, buffer,
+                   [buffer_size](const size_t n) { return n <= buffer_size; });
+    }
+
+    /**
+     * @code split()@endcode with no buffer, so all the elements for @code left@endcode are put in it.
+     */
+    template <typename TSrc, typename TLeft, typename TRight, typename Compare>
+      requires(tape<TSrc>::READABLE && tape<TLeft>::WRITABLE && tape<TRight>::WRITABLE)
+    std::tuple<subarray_info<Compare>, size_t, subarray_info<Compare>> split(tape<TSrc>& source, tape<TLeft>& left,
+                                                                             tape<TRight>& right, Compare compare,
+                                                                             const int32_t key, const size_t size,
+                                                                             random_generator& gen) {
+      std::vector<int32_t> buffer;
+      return split(source, left, right, compare, key, size, gen, buffer, 0);
+    }
+
+    /**
+     * Sort the @code buffer@endcode with @code threads@endcode threads, @code put()@endcode the elements in
+     * @code out@endcode and free the memory.<br>
+     * The buffer and the scratch memory of the @code sort_leaf()@endcode take no more than @code chunk_size@endcode
+     * elements.
+     * @throws io_exception if writing fails
+     */
+    template <typename Out, typename Compare>
+      requires(output<Out>)
+    void flush_sorted(std::vector<int32_t>& buffer, Out& out, const size_t chunk_size, Compare compare,
+                      const size_t threads) {
+      sort_leaf(buffer, compare, chunk_size - buffer.size(), threads);
+      vec_to_tape(buffer, out);
+      buffer.clear();
+      buffer.shrink_to_fit();
+    }
+
+    /**
+     * Reader of the elements before the head of the tape with @code peek()@endcode,
+     * which detects the ends of the runs (in the reading order).
+     */
+    template <typename T, typename Compare>
+      requires(tape<T>::READABLE)
+    class natural_run_reader {
+    private:
+      tape<T>& current_;
+      size_t size_;
+      Compare compare_;
+      bool empty_;
+      bool run_end_ = false;
+      int32_t value_ = 0;
+
+    public:
+      /**
+       * @param current tape to read
+       * @param size the count of the elements to read
+       * @param compare comparator which defines the ordering
+       * @throws io_exception if reading fails
+       */
+      natural_run_reader(tape<T>& current, const size_t size, Compare compare)
+          : current_(current),
+            size_(size),
+            compare_(compare),
+            empty_(size == 0) {
+        if (!empty_) {
+          value_ = peek(current_);
+          --size_;
+        }
+      }
+
+      /**
+       * @return @code true@endcode if all the elements are read.
+       */
+      [[nodiscard]] bool empty() const {
+        return empty_;
+      }
+
+      /**
+       * @return @code true@endcode if the last read element is the last element of its run.
+       */
+      [[nodiscard]] bool run_end() const {
+        return run_end_;
+      }
+
+      /**
+       * @return the next element to read.
+       */
+      [[nodiscard]] int32_t value() const {
+        return value_;
+      }
+
+      /**
+       * Read the next element.
+       * @throws io_exception if reading fails
+       */
+      int32_t read() {
+        const int32_t value = value_;
+        if (size_ == 0) {
+          empty_ = run_end_ = true;
+        } else {
+          value_ = peek(current_);
+          --size_;
+          run_end_ = compare_(value_, value);
+        }
+        return value;
+      }
+    };
+
+    /**
+     * Merge the runs of @code left@endcode and @code right@endcode pairwise and @code put()@endcode them in
+     * @code out@endcode. So the count of the runs in @code out@endcode does not exceed the maximum of the counts
+     * of the runs of @code left@endcode and @code right@endcode.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename Out, typename TL, typename TR, typename Compare>
+      requires(output<Out>)
+    void merge_natural_runs(natural_run_reader<TL, Compare>& left, natural_run_reader<TR, Compare>& right,
+                            Out& out, Compare compare) {
+      while (!left.empty() || !right.empty()) {
+        bool in_left = !left.empty();
+        bool in_right = !right.empty();
+        while (in_left || in_right) {
+          if (in_left && (!in_right || !compare(right.value(), left.value()))) {
+            put(out, left.read());
+            in_left = !left.run_end();
+          } else {
+            put(out, right.read());
+            in_right = !right.run_end();
+          }
+        }
+      }
+    }
+
+    /**
+     * @code peek()@endcode @code size@endcode elements from @code current@endcode and
+     * @code put()@endcode them in @code out@endcode in the sorted order using the natural merge sort on three tapes.<br>
+     * The runs are distributed over @code tmp1@endcode and @code tmp2@endcode and merged back to
+     * @code current@endcode until each of the temporary tapes contains no more than one run. So the count of
+     * the passes is @code O(log(size / chunk_size))@endcode regardless of the data.<br>
+     * @code current@endcode, @code tmp1@endcode and @code tmp2@endcode data before the head and the head position
+     * are not changed after the call. The data after the head can be lost.<br>
+     * @code out@endcode head is after the last elements put after the call.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename Out, typename T1, typename T2, typename T3, typename Compare>
+      requires(output<Out> && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+    void merge_sort_impl(Out& out, tape<T1>& current, tape<T2>& tmp1, tape<T3>& tmp2, const size_t size,
+                         const size_t chunk_size, Compare compare) {
+      // the runs are stored in tmp1 and tmp2 in the reversed order, so they are sorted when peeked
+      std::array<size_t, 2> sizes{};
+      std::array<size_t, 2> runs{};
+      std::array<int32_t, 2> last{};
+      auto append = [&](const size_t target, const int32_t value, const bool run_start) {
+        // the new run continues the previous one, if they are sorted together when peeked
+        runs[target] += run_start && (sizes[target] == 0 || compare(last[target], value));
+        target == 0 ? put(tmp1, value) : put(tmp2, value);
+        last[target] = value;
+        ++sizes[target];
+      };
+
+      const size_t run_size = std::max<size_t>(chunk_size, 1);
+      size_t target = 1;
+      for (size_t done = 0; done < size; done += run_size) {
+        auto vec = tape_to_vec(current, std::min(run_size, size - done));
+        std::sort(vec.begin(), vec.end(), [compare](const int32_t l, const int32_t r) { return compare(r, l); });
+        target ^= 1;
+        for (size_t i = 0; i < vec.size(); ++i) {
+          append(target, vec[i], i == 0);
+        }
+      }
+
+      while (true) {
+        natural_run_reader left(tmp1, sizes[0], compare);
+        natural_run_reader right(tmp2, sizes[1], compare);
+        if (runs[0] <= 1 && runs[1] <= 1) {
+          merge_natural_runs(left, right, out, compare);
+          return;
+        }
+        merge_natural_runs(left, right, current, compare);
+
+        // the merged runs are sorted in current, so they are reversed when peeked
+        sizes = runs = {};
+        int32_t prev = 0;
+        for (size_t i = 0; i < size; ++i) {
+          const int32_t value = peek(current);
+          const bool run_start = i == 0 || compare(prev, value);
+          target ^= run_start;
+          append(target, value, run_start);
+          prev = value;
+        }
+      }
     }
 
+    /**
+     * Call @code f@endcode with the @code i@endcode-th of the tapes.
+     */
+    template <typename Tapes, typename F>
+    void visit_tape(Tapes& tapes, const size_t i, F f) {
+      switch (i) {
+      case 0:
+        f(std::get<0>(tapes));
+        break;
+      case 1:
+        f(std::get<1>(tapes));
+        break;
+      default:
+        f(std::get<2>(tapes));
+      }
+    }
+
+    /**
+     * The subarray to sort by the @code sort_impl()@endcode.
+     */
+    template <typename Compare>
+    class sort_task {
+    public:
+      /**
+       * Index of the tape containing the subarray.
+       */
+      size_t current;
+
+      /**
+       * Information about the subarray.
+       */
+      subarray_info<Compare> info;
+
+      /**
+       * The count of the unbalanced splits left, before the merge sort is used.
+       */
+      size_t bad_splits;
+
+      /**
+       * The element, which copies are put before the subarray.
+       */
+      int32_t key;
+
+      /**
+       * The count of the copies of the @code key@endcode.
+       */
+      size_t copies;
+    };
+
     /**
      * @code peek()@endcode @code info.size()@endcode elements from @code current@endcode and
      * @code put()@endcode them in @code out@endcode in the sorted order. <br>
@@ -159,32 +560,169 @@ namespace tape {
      * @code tmp1@endcode and @code tmp2@endcode data before the head and the head position are not changed after the
      * call. The data after the head can be lost.<br>
      * @code out@endcode head is after the last elements put after the call.<br>
-     * If @code info.size() <= chunk_size@endcode, the sorting is performed in memory. Otherwise, recursively.
+     * If @code info.size() <= chunk_size@endcode, the sorting is performed in memory. Otherwise, the elements are
+     * split by the median of the @code info.sample()@endcode and the parts are sorted with an explicit stack of
+     * the subarrays, so the left part is sorted first and its parts are stored above the right part on the tapes.<br>
+     * As in the <a href="https://en.wikipedia.org/wiki/Introsort">introsort</a>, after
+     * @code log2(info.size())@endcode splits, which leave more than @code 7 / 8@endcode of the elements in a part,
+     * the part is sorted by the @code merge_sort_impl()@endcode. So the count of the passes is
+     * @code O(log(info.size()))@endcode in the worst case.<br>
+     * The left part of each split is kept in memory while it has no more than @code chunk_size@endcode elements,
+     * so the parts, which fit in memory, are sorted without writing them to the tapes.<br>
+     * The parts, which fit in memory, are sorted and put in @code out@endcode by the @code leaf_pipeline@endcode,
+     * so the next part is read from its tape while the previous ones are sorted and written. The parts in memory
+     * share the @code chunk_size@endcode elements budget, and each of them is sorted with @code threads@endcode
+     * threads.
      * @throws io_exception if reading or writing to some of the tapes fails
      */
-    template <typename TOut, typename T1, typename T2, typename T3, typename Compare>
-      requires(tape<TOut>::WRITABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
-    void sort_impl(tape<TOut>& out, tape<T1>& current, tape<T2>& tmp1, tape<T3>& tmp2,
-                   const subarray_info<Compare>& info, const size_t chunk_size, Compare compare) {
-      if (info.size() == 0) {
-        return;
+    template <typename Out, typename T1, typename T2, typename T3, typename Compare>
+      requires(output<Out> && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+    void sort_impl(Out& out, tape<T1>& current, tape<T2>& tmp1, tape<T3>& tmp2,
+                   const subarray_info<Compare>& info, const size_t chunk_size, Compare compare,
+                   const size_t threads) {
+      std::tuple<tape<T1>&, tape<T2>&, tape<T3>&> tapes(current, tmp1, tmp2);
+      std::vector<sort_task<Compare>> tasks;
+      std::vector<int32_t> buffer;
+      leaf_pipeline<Out, Compare> pipeline(out, compare, chunk_size, threads);
+      tasks.push_back({0, info, static_cast<size_t>(std::bit_width(info.size())), 0, 0});
+
+      while (!tasks.empty()) {
+        const sort_task<Compare> task = std::move(tasks.back());
+        tasks.pop_back();
+
+        const size_t size = task.info.size();
+        const size_t left = (task.current + 1) % 3;
+        const size_t right = (task.current + 2) % 3;
+        if (size != 0 && size <= chunk_size && !task.info.equal()) {
+          // the memory is reserved as the leaf is read, so the reading starts while the previous leaves are written
+          visit_tape(tapes, task.current, [&](auto& src) {
+            std::vector<int32_t> vec;
+            for (size_t i = 0; i < size; ++i) {
+              pipeline.reserve(i + 1);
+              if (vec.size() == vec.capacity()) {
+                vec.reserve(std::min(size, pipeline.reserved()));
+              }
+              vec.push_back(peek(src));
+            }
+            pipeline.submit(task.key, task.copies, std::move(vec));
+          });
+          pipeline.release();
+          continue;
+        }
+        if (task.copies != 0) {
+          pipeline.submit(task.key, task.copies, {}, true);
+        }
+        if (size == 0) {
+          continue;
+        }
+        if (task.info.equal()) {
+          if constexpr (DEDUPLICATING<Out>) {
+            // a single element is kept, so the subarray is skipped instead of reading
+            visit_tape(tapes, task.current, [&](auto& src) { src.seek(-size); });
+            pipeline.submit(task.info.element(), size, {}, true);
+          } else {
+            pipeline.wait();
+            visit_tape(tapes, task.current, [&](auto& src) {
+              for (size_t i = 0; i < size; ++i) {
+                put(out, peek(src));
+              }
+            });
+          }
+          continue;
+        }
+        if (task.bad_splits == 0) {
+          pipeline.wait();
+          visit_tape(tapes, task.current, [&](auto& src) {
+            visit_tape(tapes, left, [&](auto& l) {
+              visit_tape(tapes, right, [&](auto& r) { merge_sort_impl(out, src, l, r, size, chunk_size, compare); });
+            });
+          });
+          continue;
+        }
+
+        const int32_t key = task.info.median();
+        // the memory is reserved as the buffer grows, so the split starts while the previous leaves are written
+        auto fits = [&](const size_t n) {
+          if (n > chunk_size) {
+            return false;
+          }
+          pipeline.reserve(n);
+          return true;
+        };
+        visit_tape(tapes, task.current, [&](auto& src) {
+          visit_tape(tapes, left, [&](auto& l) {
+            visit_tape(tapes, right, [&](auto& r) {
+              auto [left_info, equal, right_info] =
+                  split<>(src, l, r, compare, key, size, task.info.generator(), buffer, fits);
+              const bool bad = std::max(left_info.size(), right_info.size()) > size - size / 8;
+              const size_t bad_splits = task.bad_splits - bad;
+              tasks.push_back({right, std::move(right_info), bad_splits, key, equal});
+              if (left_info.size() == buffer.size()) {
+                pipeline.submit(0, 0, std::exchange(buffer, {}));
+              } else {
+                tasks.push_back({left, std::move(left_info), bad_splits, 0, 0});
+              }
+              pipeline.release();
+            });
+          });
+        });
       }
-      if (info.equal()) {
+      pipeline.wait();
+    }
+
+    /**
+     * The @code sort()@endcode with the three temporary tapes, which puts the elements to any output.
+     */
+    template <typename TIn, typename Out, typename T1, typename T2, typename T3, typename Compare>
+      requires(tape<TIn>::READABLE && output<Out> && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL &&
+               tape<T3>::BIDIRECTIONAL)
+    void sort_tapes_impl(tape<TIn>& in, Out& out, tape<T1>& tmp1, tape<T2>& tmp2, tape<T3>& tmp3,
+                         const size_t chunk_size, Compare compare, const size_t threads) {
+      random_generator gen(std::random_device{}());
+      subarray_info<Compare> info(compare, gen);
+      presortedness<Compare> stats(compare, chunk_size / 2);
+
+      while (!in.is_end()) {
+        const int32_t value = in.get();
+        in.next();
+        info.update(value);
+        stats.update(value);
+      }
+
+      switch (choose_strategy(stats, chunk_size, false)) {
+      case strategy::copy:
+        in.seek(-info.size());
+        helpers::copy(in, out, info.size());
+        break;
+      case strategy::reverse:
         for (size_t i = 0; i < info.size(); ++i) {
-          helpers::put(out, helpers::peek(current));
+          put(out, peek(in));
         }
-        return;
-      }
-      if (info.size() <= chunk_size) {
-        auto vec = tape_to_vec(current, info.size());
-        std::sort(vec.begin(), vec.end(), compare);
+        break;
+      case strategy::counting:
+        put_counts(stats, out);
+        in.seek(-info.size());
+        break;
+      case strategy::memory: {
+        auto vec = tape_to_vec(in, info.size());
+        sort_leaf(vec, compare, chunk_size - info.size(), threads);
         vec_to_tape(vec, out);
-        return;
+        break;
+      }
+      default:
+        // the right part stays in tmp2 below the parts of the left one
+        const int32_t key = info.median();
+        std::vector<int32_t> buffer;
+        auto [left_info, equal, right_info] =
+            split<>(in, tmp1, tmp2, compare, key, info.size(), gen, buffer, chunk_size);
+        if (left_info.size() == buffer.size()) {
+          flush_sorted(buffer, out, chunk_size, compare, threads);
+        } else {
+          sort_impl(out, tmp1, tmp3, tmp2, left_info, chunk_size, compare, threads);
+        }
+        put_copies(out, key, equal);
+        sort_impl(out, tmp2, tmp1, tmp3, right_info, chunk_size, compare, threads);
       }
-
-      auto [left_info, right_info] = split<>(current, tmp1, tmp2, compare, info.element(), info.size());
-      sort_impl(out, tmp1, current, tmp2, left_info, chunk_size, compare);
-      sort_impl(out, tmp2, current, tmp1, right_info, chunk_size, compare);
     }
   } // namespace helpers
 
@@ -192,17 +730,22 @@ namespace tape {
    * Put elements from @code in@endcode to @code out@endcode in the sorted order. <br>
    * @code in@endcode is not changed after the call.<br>
    * @code out@endcode head is after the last elements put after the call.<br>
-   * The function uses as much allocated memory as the @code in@endcode data occupies.<br>
+   * The function uses as much allocated memory as the @code in@endcode data occupies, and no more than
+   * @code scratch_size@endcode elements in addition, which the @code helpers::sort_leaf()@endcode can use for the
+   * @code helpers::lsd_radix_sort()@endcode or the cached keys.<br>
    * The sort is not stable.
    *
    * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
    * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
    * @param compare comparator which defines the ordering
+   * @param scratch_size the maximum count of the elements, which can be allocated in addition to the data
+   * @param threads the maximum count of the threads, which sort the elements
    * @throws io_exception if reading or writing to some of the tapes fails
    */
   template <typename TIn, typename TOut, typename Compare = std::less<int32_t>>
     requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE)
-  void sort(tape<TIn>& in, tape<TOut>& out, Compare compare = Compare()) {
+  void sort(tape<TIn>& in, tape<TOut>& out, Compare compare = Compare(),
+            const size_t scratch_size = std::numeric_limits<size_t>::max(), const size_t threads = 1) {
     std::vector<int32_t> vec;
     size_t size = 0;
     while (!in.is_end()) {
@@ -214,7 +757,7 @@ namespace tape {
 
     in.seek(-size);
 
-    std::sort(vec.begin(), vec.end(), compare);
+    helpers::sort_leaf(vec, compare, scratch_size, threads);
     helpers::vec_to_tape(vec, out);
   }
 
@@ -225,6 +768,11 @@ namespace tape {
    * changed after the call. The data after the head can be lost.<br>
    * @code out@endcode head is after the last elements put after the call.<br>
    * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory.<br>
+   * While @code in@endcode is read, the @code helpers::presortedness@endcode statistics and the sample for the pivot
+   * are gathered. The sorted and reverse sorted data is copied, the data with no more than @code chunk_size / 4@endcode
+   * distinct elements is counted in memory, so their counts fit in @code chunk_size@endcode elements. Otherwise,
+   * the quick sort is used, and its first split reads @code in@endcode directly, so the data is not copied to the
+   * temporary tapes before the sorting.<br>
    * The sort is not stable.
    *
    * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
@@ -237,23 +785,14 @@ namespace tape {
    * Should have at least as much space after the head as the size of the sorted data
    * @param chunk_size the maximum number of elements that can be stored in memory
    * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
    * @throws io_exception if reading or writing to some of the tapes fails
    */
   template <typename TIn, typename TOut, typename T1, typename T2, typename T3, typename Compare = std::less<int32_t>>
     requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL &&
              tape<T3>::BIDIRECTIONAL)
   void sort(tape<TIn>& in, tape<TOut>& out, tape<T1>& tmp1, tape<T2>& tmp2, tape<T3>& tmp3, size_t chunk_size = 0,
-            Compare compare = Compare()) {
-    helpers::subarray_info<Compare> info(compare);
-
-    while (!in.is_end()) {
-      const int32_t value = in.get();
-      in.next();
-      helpers::put(tmp1, value);
-      info.update(value);
-    }
-
-    in.seek(-info.size());
-    helpers::sort_impl(out, tmp1, tmp2, tmp3, info, chunk_size, compare);
+            Compare compare = Compare(), const size_t threads = 1) {
+    helpers::sort_tapes_impl(in, out, tmp1, tmp2, tmp3, chunk_size, compare, threads);
   }
 } // namespace tape
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+#include "merger.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * The runs of the @code stable_sort()@endcode stored on a group of the temporary tapes.<br>
+     * The i-th run (in the order of the input) is stored on the @code (i % tapes.size())@endcode-th tape of the group,
+     * so the runs of each tape are in the order of the input from the bottom to the top or vice versa.
+     */
+    class stable_runs {
+    public:
+      /**
+       * Indices of the tapes of the group.
+       */
+      std::vector<size_t> tapes;
+
+      /**
+       * Sizes of the runs of each tape of the group from the bottom to the top.
+       */
+      std::vector<std::vector<size_t>> stacks;
+
+      /**
+       * The count of the runs.
+       */
+      size_t count = 0;
+
+      /**
+       * @code true@endcode if the top of each tape is its last run, @code false@endcode if it is the first one.
+       */
+      bool top_last = true;
+
+      /**
+       * @code true@endcode if the runs are put in the sorted order, @code false@endcode if in the reversed one.
+       */
+      bool ascending = true;
+
+      explicit stable_runs(std::vector<size_t> group) : tapes(std::move(group)), stacks(tapes.size()) {}
+
+      /**
+       * Add the run of the @code size@endcode elements after the last one.
+       */
+      void push(const size_t size) {
+        stacks[count++ % tapes.size()].push_back(size);
+      }
+    };
+
+    /**
+     * @return the count of the passes of the @code stable_merge()@endcode over the @code runs@endcode runs, which
+     * are merged alternately by the groups of @code first@endcode and @code second@endcode tapes.
+     */
+    inline size_t stable_passes(size_t runs, size_t first, size_t second) {
+      size_t passes = 1;
+      for (; runs > first; ++passes) {
+        runs = (runs + first - 1) / first;
+        std::swap(first, second);
+      }
+      return passes;
+    }
+
+    /**
+     * Merge each @code from.tapes.size()@endcode consecutive runs of the @code from@endcode and add the result to
+     * the @code to@endcode. The runs are @code peek()@endcode-ed, so the order of the result is opposite to the order
+     * of the merged runs. Among the equivalent elements the ones from the earlier runs are put first in the sorted
+     * order, so the merge is stable.<br>
+     * The runs are taken from the tops of the tapes, so the top of the @code to@endcode tapes is the last run
+     * if the top of the @code from@endcode tapes is the first one and vice versa.
+     * @throws io_exception if reading or writing to some of the tapes fails
+     */
+    template <typename T, typename Compare>
+      requires(tape<T>::BIDIRECTIONAL)
+    void stable_merge(std::span<tape<T>> tmps, stable_runs& from, stable_runs& to, Compare compare) {
+      const size_t ways = from.tapes.size();
+      const size_t groups = (from.count + ways - 1) / ways;
+      for (size_t g = 0; g < groups; ++g) {
+        const size_t group = from.top_last ? groups - 1 - g : g;
+        const size_t count = std::min(ways, from.count - group * ways);
+
+        std::vector<run_reader<T>> sources;
+        for (size_t i = 0; i < count; ++i) {
+          // the loser tree pops the equal heads from the sources with the least index first
+          const size_t t = from.ascending ? count - 1 - i : i;
+          sources.emplace_back(tmps[from.tapes[t]], from.stacks[t].back());
+          from.stacks[t].pop_back();
+        }
+
+        tape<T>& out = tmps[to.tapes[group % to.tapes.size()]];
+        size_t size;
+        if (from.ascending) {
+          size = merge_runs(std::move(sources), out, [&compare](const int32_t l, const int32_t r) {
+            return compare(r, l);
+          });
+        } else {
+          size = merge_runs(std::move(sources), out, compare);
+        }
+        to.stacks[group % to.tapes.size()].push_back(size);
+      }
+      to.count = groups;
+      to.top_last = !from.top_last;
+      to.ascending = !from.ascending;
+      from.count = 0;
+    }
+  } // namespace helpers
+
+  /**
+   * Put elements from @code in@endcode to @code out@endcode in the sorted order keeping the order of the equivalent
+   * elements.<br>
+   * The runs are sorted in memory by the @code helpers::stable_sort_leaf()@endcode and distributed over the first
+   * half of the temporary tapes. Then the runs are merged by the balanced merge with the
+   * @code helpers::loser_tree@endcode: each pass merges the consecutive runs of one half of the tapes and distributes
+   * the results over the other half, so the runs stay in the order of the input and the equal elements of the
+   * different runs are put in the order of the runs. The runs are always @code peek()@endcode-ed, so their order
+   * alternates between the passes, and the order of the first runs is chosen so that the last pass puts the elements
+   * to @code out@endcode in the sorted order.<br>
+   * With 3 temporary tapes the passes alternate the merge of 2 runs and the redistribution of the result.<br>
+   * The size of the data is counted by moving the @code in@endcode head before the sorting, no elements are read.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmps@endcode data before the head and the head position are not changed after the call.
+   * The data after the head can be lost.<br>
+   * @code out@endcode head is after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory for the
+   * elements and the scratch memory of the stable sort in memory, so the runs are half as large as the
+   * @code chunk_size@endcode unless the comparator is @code helpers::natural_order@endcode.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param tmps at least 3 temporary tapes. Must be readable and writable.
+   * Each should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the runs of the @code helpers::natural_order@endcode
+   * comparators in memory
+   * @throws std::invalid_argument if less than 3 temporary tapes are given
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename T, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T>::BIDIRECTIONAL)
+  void stable_sort(tape<TIn>& in, tape<TOut>& out, std::span<tape<T>> tmps, const size_t chunk_size = 0,
+                   Compare compare = Compare(), const size_t threads = 1) {
+    if (tmps.size() < 3) {
+      throw std::invalid_argument("at least 3 temporary tapes expected");
+    }
+    const size_t run_size = std::max<size_t>(helpers::natural_order<Compare> ? chunk_size : chunk_size / 2, 1);
+    const size_t memory = std::max(chunk_size, run_size);
+
+    size_t size = 0;
+    while (!in.is_end()) {
+      in.next();
+      ++size;
+    }
+    in.seek(-size);
+
+    std::vector<int32_t> vec;
+    vec.reserve(std::min(size, run_size));
+    if (size <= run_size) {
+      while (!in.is_end()) {
+        vec.push_back(in.get());
+        in.next();
+      }
+      in.seek(-size);
+
+      helpers::stable_sort_leaf(vec, compare, memory - size, threads);
+      helpers::vec_to_tape(vec, out);
+      return;
+    }
+
+    std::vector<size_t> first;
+    std::vector<size_t> second;
+    for (size_t i = 0; i < tmps.size(); ++i) {
+      (i < tmps.size() - tmps.size() / 2 ? first : second).push_back(i);
+    }
+    helpers::stable_runs current(std::move(first));
+    helpers::stable_runs next(std::move(second));
+
+    // each pass reverses the order of the runs, and the last one should put them in the sorted order
+    const size_t runs = (size + run_size - 1) / run_size;
+    current.ascending = helpers::stable_passes(runs, current.tapes.size(), next.tapes.size()) % 2 == 0;
+    for (size_t r = 0; r < runs; ++r) {
+      vec.clear();
+      while (vec.size() < run_size && !in.is_end()) {
+        vec.push_back(in.get());
+        in.next();
+      }
+
+      helpers::stable_sort_leaf(vec, compare, memory - vec.size(), threads);
+      if (!current.ascending) {
+        std::reverse(vec.begin(), vec.end());
+      }
+      helpers::vec_to_tape(vec, tmps[current.tapes[current.count % current.tapes.size()]]);
+      current.push(vec.size());
+    }
+    in.seek(-size);
+
+    while (current.count > current.tapes.size()) {
+      helpers::stable_merge(tmps, current, next, compare);
+      std::swap(current, next);
+    }
+
+    std::vector<helpers::run_reader<T>> sources;
+    for (size_t t = 0; t < current.count; ++t) {
+      sources.emplace_back(tmps[current.tapes[t]], current.stacks[t].back());
+    }
+    helpers::merge_runs(std::move(sources), out, compare);
+  }
+} // namespace tape
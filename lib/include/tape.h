@@ -178,6 +178,13 @@ namespace tape {
       return pos == 0;
     }
 
+    /**
+     * Returns the config of the emulated delays of the tape.
+     */
+    [[nodiscard]] const delay_config& get_delays() const noexcept {
+      return delays;
+    }
+
     /**
      * Move head by @code diff@endcode positions.
      * If @code diff < 0@endcode, the head moves backwards.<br>
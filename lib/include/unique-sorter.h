@@ -0,0 +1,151 @@
+#pragma once
+#include "output.h"
+#include "sorter.h"
+#include "tape.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace tape {
+  namespace helpers {
+    /**
+     * Output, which puts one element of each group of the equivalent elements put one after another and
+     * the counts of the elements of the groups.<br>
+     * The pending group is put when the next one starts or the @code flush()@endcode is called.
+     */
+    template <typename TOut, typename TCounts, typename Compare>
+      requires(tape<TOut>::WRITABLE && tape<TCounts>::WRITABLE)
+    class unique_writer {
+    private:
+      tape<TOut>& out_;
+      tape<TCounts>* counts_;
+      Compare compare_;
+      int32_t last_ = 0;
+      size_t count_ = 0;
+      size_t size_ = 0;
+
+    public:
+      /**
+       * @param out tape to put the elements
+       * @param counts tape to put the counts of the elements or @code nullptr@endcode
+       * @param compare comparator which defines the equivalence
+       */
+      unique_writer(tape<TOut>& out, tape<TCounts>* counts, Compare compare)
+          : out_(out),
+            counts_(counts),
+            compare_(compare) {}
+
+      /**
+       * Add @code count@endcode copies of the @code value@endcode to the pending group, if they are equivalent to
+       * its elements. Otherwise, put the pending group and start the new one.
+       * @throws io_exception if writing fails
+       */
+      void put(const int32_t value, const size_t count) {
+        if (count == 0) {
+          return;
+        }
+        if (count_ != 0 && !compare_(last_, value) && !compare_(value, last_)) {
+          count_ += count;
+          return;
+        }
+        flush();
+        last_ = value;
+        count_ = count;
+      }
+
+      /**
+       * Put the pending group. The counts, which do not fit in @code int32_t@endcode, are put as its maximum.
+       * @throws io_exception if writing fails
+       */
+      void flush() {
+        if (count_ == 0) {
+          return;
+        }
+        helpers::put(out_, last_);
+        if (counts_ != nullptr) {
+          helpers::put(*counts_, static_cast<int32_t>(std::min<size_t>(count_, std::numeric_limits<int32_t>::max())));
+        }
+        ++size_;
+        count_ = 0;
+      }
+
+      /**
+       * @return count of the elements put.
+       */
+      [[nodiscard]] size_t size() const {
+        return size_;
+      }
+    };
+
+    template <typename TOut, typename TCounts, typename Compare>
+    constexpr bool DEDUPLICATING<unique_writer<TOut, TCounts, Compare>> = true;
+
+    template <typename TOut, typename TCounts, typename Compare>
+    void put(unique_writer<TOut, TCounts, Compare>& out, const int32_t value) {
+      out.put(value, 1);
+    }
+
+    template <typename TOut, typename TCounts, typename Compare>
+    void put_copies(unique_writer<TOut, TCounts, Compare>& out, const int32_t value, const size_t count) {
+      out.put(value, count);
+    }
+  } // namespace helpers
+
+  /**
+   * Put one element of each group of the equivalent elements from @code in@endcode to @code out@endcode in the sorted
+   * order, and the counts of the elements of the groups to @code counts@endcode.<br>
+   * The elements are sorted as by the @code sort()@endcode with the three temporary tapes, but the duplicates are
+   * dropped as early as possible: the data with few distinct elements is counted in memory, the copies of the
+   * pivots are only counted by the splits, the subarrays of the equivalent elements are skipped instead of reading,
+   * and the duplicates of the parts sorted in memory and of the merged runs are not put.<br>
+   * @code in@endcode is not changed after the call.<br>
+   * @code tmp1@endcode, @code tmp2@endcode and @code tmp3@endcode data before the head and the head position are not
+   * changed after the call. The data after the head can be lost.<br>
+   * @code out@endcode and @code counts@endcode heads are after the last elements put after the call.<br>
+   * The function uses no more than @code chunk_size * sizeof(int32_t)@endcode bytes of allocated memory.
+   *
+   * @param in tape with elements to sort. Can be read-only. The head should be at the beginning of the data
+   * @param out tape to write the sorted elements. Can be write-only. The head should be at the first position to write
+   * @param counts tape to write the counts of the elements. Can be write-only.
+   * The head should be at the first position to write. The counts, which do not fit in @code int32_t@endcode,
+   * are put as its maximum
+   * @param tmp1 temporary tape. Must be readable and writable.
+   * Should have at least as much space after the head as the size of the sorted data
+   * @param tmp2 temporary tape. Must be readable and writable
+   * Should have at least as much space after the head as the size of the sorted data
+   * @param tmp3 temporary tape. Must be readable and writable
+   * Should have at least as much space after the head as the size of the sorted data
+   * @param chunk_size the maximum number of elements that can be stored in memory
+   * @param compare comparator which defines the ordering
+   * @param threads the maximum count of the threads, which sort the elements in memory
+   * @return count of the elements put to @code out@endcode
+   * @throws io_exception if reading or writing to some of the tapes fails
+   */
+  template <typename TIn, typename TOut, typename TCounts, typename T1, typename T2, typename T3,
+            typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<TCounts>::WRITABLE && tape<T1>::BIDIRECTIONAL &&
+             tape<T2>::BIDIRECTIONAL && tape<T3>::BIDIRECTIONAL)
+  size_t unique_sort(tape<TIn>& in, tape<TOut>& out, tape<TCounts>& counts, tape<T1>& tmp1, tape<T2>& tmp2,
+                     tape<T3>& tmp3, const size_t chunk_size = 0, Compare compare = Compare(),
+                     const size_t threads = 1) {
+    helpers::unique_writer<TOut, TCounts, Compare> writer(out, &counts, compare);
+    helpers::sort_tapes_impl(in, writer, tmp1, tmp2, tmp3, chunk_size, compare, threads);
+    writer.flush();
+    return writer.size();
+  }
+
+  /**
+   * @code unique_sort()@endcode with no counts of the elements.
+   */
+  template <typename TIn, typename TOut, typename T1, typename T2, typename T3, typename Compare = std::less<int32_t>>
+    requires(tape<TIn>::READABLE && tape<TOut>::WRITABLE && tape<T1>::BIDIRECTIONAL && tape<T2>::BIDIRECTIONAL &&
+             tape<T3>::BIDIRECTIONAL)
+  size_t unique_sort(tape<TIn>& in, tape<TOut>& out, tape<T1>& tmp1, tape<T2>& tmp2, tape<T3>& tmp3,
+                     const size_t chunk_size = 0, Compare compare = Compare(), const size_t threads = 1) {
+    helpers::unique_writer<TOut, TOut, Compare> writer(out, nullptr, compare);
+    helpers::sort_tapes_impl(in, writer, tmp1, tmp2, tmp3, chunk_size, compare, threads);
+    writer.flush();
+    return writer.size();
+  }
+} // namespace tape
@@ -0,0 +1 @@
+#include "../include/adaptive-sorter.h"
@@ -0,0 +1,7 @@
+#include "../../include/exceptions/unsorted_exception.h"
+
+namespace tape {
+  unsorted_exception::unsorted_exception(const std::string& string) : runtime_error(string) {}
+
+  unsorted_exception::unsorted_exception(const char* string) : runtime_error(string) {}
+} // namespace tape
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "../include/leaf-sort.h"
+
+#include <array>
+#include <bit>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TAPE_VECTORIZED_SORT 1
+#include <immintrin.h>
+#endif
+
+namespace tape {
+  namespace helpers {
+#ifdef TAPE_VECTORIZED_SORT
+    namespace {
+      constexpr size_t LANES = 8;
+
+      /**
+       * The subarrays of no more than this size are sorted by the sorting networks.
+       */
+      constexpr size_t SMALL_SIZE = 2 * LANES;
+
+      /**
+       * For each mask of the lanes: the indices of the lanes in the mask, then the indices of the other lanes.
+       */
+      constexpr auto COMPRESS = [] {
+        std::array<std::array<int32_t, LANES>, 1 << LANES> table{};
+        for (size_t mask = 0; mask < table.size(); ++mask) {
+          size_t next = 0;
+          for (size_t lane = 0; lane < LANES; ++lane) {
+            if (mask >> lane & 1) {
+              table[mask][next++] = static_cast<int32_t>(lane);
+            }
+          }
+          for (size_t lane = 0; lane < LANES; ++lane) {
+            if (!(mask >> lane & 1)) {
+              table[mask][next++] = static_cast<int32_t>(lane);
+            }
+          }
+        }
+        return table;
+      }();
+
+      /**
+       * The mask of the lanes, which get the maximum in the compare-exchange of the lanes @code i@endcode and
+       * @code i ^ J@endcode of the bitonic sorting network stage, which merges the blocks of the size @code K@endcode.
+       */
+      template <size_t J, size_t K>
+      constexpr int max_lanes() {
+        int mask = 0;
+        for (size_t i = 0; i < LANES; ++i) {
+          const bool ascending = (i & K) == 0;
+          if (ascending == (i > (i ^ J))) {
+            mask |= 1 << i;
+          }
+        }
+        return mask;
+      }
+
+      template <size_t J, size_t K>
+      __attribute__((target("avx2"))) __m256i bitonic_step(const __m256i v) {
+        const __m256i partner = _mm256_setr_epi32(0 ^ J, 1 ^ J, 2 ^ J, 3 ^ J, 4 ^ J, 5 ^ J, 6 ^ J, 7 ^ J);
+        const __m256i p = _mm256_permutevar8x32_epi32(v, partner);
+        return _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), max_lanes<J, K>());
+      }
+
+      /**
+       * Sort the lanes of the bitonic vector.
+       */
+      __attribute__((target("avx2"))) __m256i bitonic_merge(__m256i v) {
+        v = bitonic_step<4, LANES>(v);
+        v = bitonic_step<2, LANES>(v);
+        return bitonic_step<1, LANES>(v);
+      }
+
+      /**
+       * Sort the lanes of the vector.
+       */
+      __attribute__((target("avx2"))) __m256i sort_vector(__m256i v) {
+        v = bitonic_step<1, 2>(v);
+        v = bitonic_step<2, 4>(v);
+        v = bitonic_step<1, 4>(v);
+        return bitonic_merge(v);
+      }
+
+      /**
+       * Sort no more than @code SMALL_SIZE@endcode elements with the sorting network.
+       */
+      __attribute__((target("avx2"))) void sort_small(int32_t* data, const size_t size) {
+        std::array<int32_t, SMALL_SIZE> buffer;
+        buffer.fill(std::numeric_limits<int32_t>::max());
+        std::copy(data, data + size, buffer.begin());
+
+        __m256i low = sort_vector(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer.data())));
+        __m256i high = sort_vector(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer.data() + LANES)));
+        high = _mm256_permutevar8x32_epi32(high, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        const __m256i min = _mm256_min_epi32(low, high);
+        const __m256i max = _mm256_max_epi32(low, high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(buffer.data()), bitonic_merge(min));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(buffer.data() + LANES), bitonic_merge(max));
+
+        std::copy(buffer.begin(), buffer.begin() + size, data);
+      }
+
+      /**
+       * @return the mask of the lanes, which are less (or not greater if @code INCLUSIVE@endcode) than the pivot.
+       */
+      template <bool INCLUSIVE>
+      __attribute__((target("avx2"))) int left_mask(const __m256i v, const __m256i pivots) {
+        if constexpr (INCLUSIVE) {
+          return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, pivots))) & 0xFF;
+        } else {
+          return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(pivots, v)));
+        }
+      }
+
+      /**
+       * Move the elements, which are less (or not greater if @code INCLUSIVE@endcode) than the pivot,
+       * to the beginning of the subarray. The size should be at least @code 2 * LANES@endcode.<br>
+       * The first and the last vectors are kept in registers, so there is always a free space of
+       * @code 2 * LANES@endcode elements, and the next vector is read from the side with less free space.
+       * So the vectors can be stored to the both sides entirely with no unread elements overwritten.
+       * @return count of the elements moved to the beginning.
+       */
+      template <bool INCLUSIVE>
+      __attribute__((target("avx2"))) size_t partition(int32_t* data, const size_t size, const int32_t pivot) {
+        const __m256i pivots = _mm256_set1_epi32(pivot);
+        size_t write_left = 0;
+        size_t write_right = size;
+
+        const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        const __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + size - LANES));
+        size_t read_left = LANES;
+        size_t read_right = size - LANES;
+        while (read_right - read_left >= LANES) {
+          __m256i v;
+          if (read_left - write_left <= write_right - read_right) {
+            v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + read_left));
+            read_left += LANES;
+          } else {
+            read_right -= LANES;
+            v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + read_right));
+          }
+
+          const int mask = left_mask<INCLUSIVE>(v, pivots);
+          const __m256i order = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(COMPRESS[mask].data()));
+          const __m256i permuted = _mm256_permutevar8x32_epi32(v, order);
+          const size_t left = std::popcount(static_cast<unsigned>(mask));
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + write_left), permuted);
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + write_right - LANES), permuted);
+          write_left += left;
+          write_right -= LANES - left;
+        }
+
+        std::array<int32_t, 3 * LANES> rest;
+        const size_t remaining = read_right - read_left;
+        std::copy(data + read_left, data + read_right, rest.begin());
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rest.data() + remaining), first);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rest.data() + remaining + LANES), last);
+        for (size_t i = 0; i < remaining + 2 * LANES; ++i) {
+          const int32_t value = rest[i];
+          if (INCLUSIVE ? value <= pivot : value < pivot) {
+            data[write_left++] = value;
+          } else {
+            data[--write_right] = value;
+          }
+        }
+        return write_left;
+      }
+
+      __attribute__((target("avx2"))) void sort_vectorized(int32_t* data, size_t size, size_t depth) {
+        while (size > SMALL_SIZE) {
+          if (depth-- == 0) {
+            std::sort(data, data + size);
+            return;
+          }
+
+          const int32_t a = data[0];
+          const int32_t b = data[size / 2];
+          const int32_t c = data[size - 1];
+          const int32_t pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+          size_t left = partition<false>(data, size, pivot);
+          if (left == 0) {
+            // there are no elements less than the pivot, so the elements equal to it are sorted already
+            left = partition<true>(data, size, pivot);
+            data += left;
+            size -= left;
+            continue;
+          }
+
+          // the smaller part is sorted recursively, so the recursion depth is logarithmic
+          if (left < size - left) {
+            sort_vectorized(data, left, depth);
+            data += left;
+            size -= left;
+          } else {
+            sort_vectorized(data + left, size - left, depth);
+            size = left;
+          }
+        }
+        sort_small(data, size);
+      }
+    } // namespace
+#endif
+
+    bool vectorized_sort_supported() {
+#ifdef TAPE_VECTORIZED_SORT
+      static const bool supported = __builtin_cpu_supports("avx2");
+      return supported;
+#else
+      return false;
+#endif
+    }
+
+    void sort_int32(int32_t* data, const size_t size) {
+#ifdef TAPE_VECTORIZED_SORT
+      if (vectorized_sort_supported()) {
+        sort_vectorized(data, size, 2 * std::bit_width(size));
+        return;
+      }
+#endif
+      std::sort(data, data + size);
+    }
+  } // namespace helpers
+} // namespace tape
@@ -0,0 +1 @@
+#include "../include/merger.h"
@@ -0,0 +1,71 @@
+#include "../include/planner.h"
+
+#include <cmath>
+
+namespace tape {
+  namespace {
+    /**
+     * @return count of the passes, which split @code size@endcode elements by @code fanout@endcode parts until
+     * the parts have no more than @code chunk_size@endcode elements.
+     */
+    double split_passes(const double size, const double chunk_size, const double fanout) {
+      if (size <= chunk_size) {
+        return 0;
+      }
+      return std::ceil(std::log(size / chunk_size) / std::log(fanout));
+    }
+  } // namespace
+
+  void operation_counts::add_passes(const double passes, const double size) {
+    reads += passes * size;
+    writes += passes * size;
+    moves += 2 * passes * size;
+  }
+
+  void operation_counts::add_rewinds(const double count, const double steps) {
+    rewinds += count;
+    rewind_steps += steps;
+  }
+
+  double operation_counts::time(const delay_config& delays) const {
+    return reads * static_cast<double>(delays.read_delay) + writes * static_cast<double>(delays.write_delay) +
+           moves * static_cast<double>(delays.next_delay) + rewinds * static_cast<double>(delays.rewind_delay) +
+           rewind_steps * static_cast<double>(delays.rewind_step_delay);
+  }
+
+  operation_counts estimate_quick(const size_t size, const size_t chunk_size, const size_t tmps) {
+    const auto n = static_cast<double>(size);
+    const auto buckets = static_cast<double>(std::bit_floor(std::max<size_t>(tmps - 1, 2)));
+    operation_counts counts;
+    // the splits and the pass, which reads the buckets to memory and puts them to the output
+    counts.add_passes(split_passes(n, static_cast<double>(std::max<size_t>(chunk_size, 1)), buckets) + 1, n);
+    counts.add_rewinds(1, n);
+    return counts;
+  }
+
+  operation_counts estimate_merge(const size_t size, const size_t runs, const size_t tmps) {
+    const auto n = static_cast<double>(size);
+    const auto ways = static_cast<double>(std::max<size_t>(tmps - 1, 2));
+    operation_counts counts;
+    // the distribution of the runs
+    counts.add_passes(1, n);
+    counts.add_rewinds(1, n);
+    for (auto left = static_cast<double>(runs); left > 1; left = std::ceil(left / ways)) {
+      counts.add_passes(1, n);
+      counts.add_rewinds(left, n);
+    }
+    return counts;
+  }
+
+  operation_counts estimate_radix(const size_t size, const size_t chunk_size, const size_t tmps,
+                                  const size_t key_bits) {
+    const auto n = static_cast<double>(size);
+    const auto digit_bits = static_cast<double>(std::bit_width(std::max<size_t>(tmps - 1, 2)) - 1);
+    const auto chunk = static_cast<double>(std::max<size_t>(chunk_size, 1));
+    const double bits = std::min(static_cast<double>(key_bits), split_passes(n, chunk, 2));
+    operation_counts counts;
+    counts.add_passes(std::ceil(bits / digit_bits) + 1, n);
+    counts.add_rewinds(1, n);
+    return counts;
+  }
+} // namespace tape
@@ -0,0 +1,109 @@
+#include "../include/polyphase.h"
+
+#include <numeric>
+
+namespace tape {
+  namespace helpers {
+    std::vector<size_t> polyphase_distribution(const size_t inputs, const size_t runs) {
+      std::vector<size_t> distribution(inputs, 0);
+      distribution[0] = 1;
+      while (std::accumulate(distribution.begin(), distribution.end(), size_t{0}) < runs) {
+        const size_t first = distribution[0];
+        for (size_t i = 0; i + 1 < inputs; ++i) {
+          distribution[i] = first + distribution[i + 1];
+        }
+        distribution[inputs - 1] = first;
+      }
+      return distribution;
+    }
+
+    polyphase_plan::polyphase_plan(const size_t tape_count, const size_t runs)
+        : tapes(runs),
+          descending(runs),
+          dummies(tape_count, 0) {
+      if (tape_count < 3) {
+        throw std::invalid_argument("at least 3 tapes expected");
+      }
+      const size_t inputs = tape_count - 1;
+      const auto distribution = polyphase_distribution(inputs, runs);
+
+      // the dummy runs are spread so that the counts of the real runs are as close as possible
+      size_t total = std::accumulate(distribution.begin(), distribution.end(), size_t{0});
+      for (; total > runs; --total) {
+        size_t best = 0;
+        for (size_t i = 1; i < inputs; ++i) {
+          if (distribution[i] - dummies[i] > distribution[best] - dummies[best]) {
+            best = i;
+          }
+        }
+        ++dummies[best];
+      }
+
+      std::vector<std::vector<size_t>> stacks(tape_count);
+      for (size_t r = 0, i = 0; r < runs; ++r, i = (i + 1) % inputs) {
+        while (stacks[i].size() == distribution[i] - dummies[i]) {
+          i = (i + 1) % inputs;
+        }
+        stacks[i].push_back(r);
+        tapes[r] = i;
+      }
+
+      // the merges are simulated to find the count of merges each run takes part in
+      std::vector<size_t> parent(runs, OUTPUT_TAPE);
+      for (size_t i = 0; i < inputs; ++i) {
+        for (size_t d = 0; d < dummies[i]; ++d) {
+          stacks[i].push_back(parent.size());
+          parent.push_back(OUTPUT_TAPE);
+        }
+      }
+      polyphase_merge(stacks, [&parent](const std::vector<std::pair<size_t, size_t>>& tops, size_t) {
+        const size_t node = parent.size();
+        parent.push_back(OUTPUT_TAPE);
+        for (const auto& [i, child] : tops) {
+          parent[child] = node;
+        }
+        return node;
+      });
+
+      std::vector<size_t> depth(parent.size(), 0);
+      for (size_t node = parent.size(); node--;) {
+        if (parent[node] != OUTPUT_TAPE) {
+          depth[node] = depth[parent[node]] + 1;
+        }
+      }
+      for (size_t r = 0; r < runs; ++r) {
+        descending[r] = depth[r] % 2 == 1;
+      }
+    }
+
+    polyphase_distributor::polyphase_distributor(const size_t tape_count)
+        : counts_(tape_count, 1),
+          dummies_(tape_count, 1) {
+      if (tape_count < 3) {
+        throw std::invalid_argument("at least 3 tapes expected");
+      }
+      counts_.back() = dummies_.back() = 0;
+    }
+
+    size_t polyphase_distributor::next() {
+      if (!first_) {
+        if (dummies_[tape_] < dummies_[tape_ + 1]) {
+          ++tape_;
+        } else {
+          if (dummies_[tape_] == 0) {
+            // the next level of the perfect distribution
+            const size_t first = counts_[0];
+            for (size_t i = 0; i + 1 < counts_.size(); ++i) {
+              dummies_[i] = first + counts_[i + 1] - counts_[i];
+              counts_[i] = first + counts_[i + 1];
+            }
+          }
+          tape_ = 0;
+        }
+      }
+      first_ = false;
+      --dummies_[tape_];
+      return tape_;
+    }
+  } // namespace helpers
+} // namespace tape
@@ -0,0 +1 @@
+#include "../include/radix.h"
@@ -0,0 +1 @@
+#include "../include/sample-sorter.h"
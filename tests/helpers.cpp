@@ -1,5 +1,14 @@
 #include "helpers.h"
 
+size_t bit_cnt(uint32_t v) {
+  size_t res = 0;
+  while (v) {
+    res += v & 1;
+    v >>= 1;
+  }
+  return res;
+}
+
 time_checker::time_checker() : current(std::chrono::steady_clock::now()) {}
 
 int64_t time_checker::checkpoint() {
@@ -12,4 +21,20 @@ int64_t time_checker::checkpoint() {
 std::string get_file_name(const std::string& suffix) {
   return std::string("./tmp/tape_") + testing::UnitTest::GetInstance()->current_test_suite()->name() + "_" +
          testing::UnitTest::GetInstance()->current_test_info()->name() + "_" + suffix + ".txt";
-}
\ No newline at end of file
+}
+std::vector<size_t> chunk_sizes(const size_t size, const size_t factor) {
+  std::vector<size_t> sizes;
+  for (size_t chunk = 0; chunk < size; chunk = chunk * factor + 1) {
+    sizes.push_back(chunk);
+  }
+  return sizes;
+}
+
+std::vector<std::fstream> tmp_streams(std::vector<file_guard>& guards, const size_t count, const std::string& prefix) {
+  std::vector<std::fstream> streams;
+  for (size_t i = 1; i <= count; ++i) {
+    guards.emplace_back(get_file_name(prefix + std::to_string(i)));
+    streams.emplace_back(guards.back().path());
+  }
+  return streams;
+}
@@ -2,11 +2,29 @@
 
 #include "../lib/include/sorter.h"
 #include "../lib/include/tape.h"
+#include "../utilities/include/file-guard.h"
 
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <functional>
 #include <random>
+#include <sstream>
+
+inline auto cmp = std::less<int32_t>{};
+inline auto rev_cmp = std::greater<int32_t>{};
+
+template <size_t MOD>
+auto mod_cmp = [](const int32_t l, const int32_t r) { return (l % MOD) < (r % MOD); };
+
+size_t bit_cnt(uint32_t v);
+
+inline auto bit_cnt_cmp = [](const int32_t l, const int32_t r) { return bit_cnt(l) < bit_cnt(r); };
+
+inline auto unsigned_cmp = [](const uint32_t l, const uint32_t r) { return l < r; };
+
+inline std::vector<std::function<bool(int32_t, int32_t)>> comps{cmp,          rev_cmp,     mod_cmp<2>,
+                                                                mod_cmp<239>, bit_cnt_cmp, unsigned_cmp};
 
 class time_checker {
 private:
@@ -31,12 +49,91 @@ auto gen_data() {
   static std::uniform_int_distribution distribution(std::numeric_limits<int32_t>::min());
 
   std::array<int32_t, N> data{};
-  for (int32_t i = 0; i < N; ++i) {
+  for (size_t i = 0; i < N; ++i) {
     data[i] = distribution(gen);
   }
   return data;
 }
 
+/**
+ * Datasets of the same size to sort: the random elements, the elements of few distinct values and the equal elements.
+ */
+class datasets {
+public:
+  std::vector<int32_t> random;
+  std::vector<int32_t> few;
+  std::vector<int32_t> equal;
+};
+
+/**
+ * Generates the @code datasets@endcode of @code N@endcode elements. The few distinct values are the random elements
+ * modulo @code mod@endcode, the equal elements are @code value@endcode.
+ */
+template <size_t N>
+datasets gen_datasets(const int32_t mod, const int32_t value = 0) {
+  const auto data = gen_data<N>();
+  datasets result{{data.begin(), data.end()}, std::vector<int32_t>(N), std::vector<int32_t>(N, value)};
+  std::transform(result.random.begin(), result.random.end(), result.few.begin(),
+                 [mod](const int32_t v) { return v % mod; });
+  return result;
+}
+
+/**
+ * Chunk sizes less than @code size@endcode starting from 0, each next one is @code factor@endcode times the previous
+ * one plus 1.
+ */
+std::vector<size_t> chunk_sizes(size_t size, size_t factor);
+
+/**
+ * Creates the tapes of @code size@endcode elements on the @code streams@endcode.
+ */
+template <typename T>
+std::vector<tape::tape<T>> make_tapes(std::vector<T> streams, const size_t size) {
+  std::vector<tape::tape<T>> tapes;
+  for (auto& stream : streams) {
+    tapes.emplace_back(std::move(stream), size);
+  }
+  return tapes;
+}
+
+/**
+ * Creates @code count@endcode files named by the @code get_file_name()@endcode with the @code prefix@endcode and
+ * the index, and opens the streams on them. The files are removed with the @code guards@endcode.
+ */
+std::vector<std::fstream> tmp_streams(std::vector<file_guard>& guards, size_t count,
+                                      const std::string& prefix = "tmp");
+
+/**
+ * String stream, which adds the count of the elements read from it to @code reads@endcode, so the passes of the
+ * algorithms over the tapes can be checked.
+ */
+class counting_stream : public std::iostream {
+private:
+  class counting_buffer : public std::stringbuf {
+  public:
+    size_t* reads = nullptr;
+
+  protected:
+    std::streamsize xsgetn(char* s, const std::streamsize n) override {
+      const std::streamsize read = std::stringbuf::xsgetn(s, n);
+      *reads += static_cast<size_t>(read) / sizeof(int32_t);
+      return read;
+    }
+  };
+
+  counting_buffer buffer;
+
+public:
+  explicit counting_stream(size_t& reads) : std::iostream(nullptr) {
+    buffer.reads = &reads;
+    rdbuf(&buffer);
+  }
+
+  counting_stream(counting_stream&& other) noexcept : std::iostream(std::move(other)), buffer(std::move(other.buffer)) {
+    set_rdbuf(&buffer);
+  }
+};
+
 template <size_t N>
 auto gen_data_pair() {
   auto data = gen_data<N>();
@@ -80,4 +177,26 @@ void fill(tape::tape<Stream>& tp, const std::array<int32_t, N>& data, const size
   fill(tp, data, offset, N - offset);
 }
 
+/**
+ * Checks that the @code data.size()@endcode elements before the @code tp@endcode head are the permutation of
+ * @code data@endcode sorted by @code compare@endcode. The head is at the beginning of the checked elements after the call.
+ */
+template <typename Stream, typename Compare>
+void expect_sorted(tape::tape<Stream>& tp, std::vector<int32_t> data, Compare compare) {
+  auto vec = tape::helpers::tape_to_vec(tp, data.size());
+  std::reverse(vec.begin(), vec.end());
+  for (size_t i = 1; i < vec.size(); ++i) {
+    EXPECT_FALSE(compare(vec[i], vec[i - 1]));
+  }
+
+  std::sort(vec.begin(), vec.end());
+  std::sort(data.begin(), data.end());
+  EXPECT_EQ(vec, data);
+}
+
+template <typename Stream, size_t N, typename Compare>
+void expect_sorted(tape::tape<Stream>& tp, const std::array<int32_t, N>& data, Compare compare) {
+  expect_sorted(tp, std::vector<int32_t>(data.begin(), data.end()), compare);
+}
+
 std::string get_file_name(const std::string& suffix = "");
\ No newline at end of file
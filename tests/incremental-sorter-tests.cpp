@@ -0,0 +1,115 @@
+#include "../lib/include/incremental-sorter.h"
+#include "helpers.h"
+
+constexpr size_t N = 200;
+
+template <typename Compare>
+std::vector<int32_t> merge_batch_test(std::vector<int32_t> existing_data, const std::vector<int32_t>& batch_data,
+                                      const size_t chunk_size, Compare compare) {
+  std::sort(existing_data.begin(), existing_data.end(), compare);
+  tape::tape existing(std::stringstream(), existing_data.size());
+  tape::tape batch(std::stringstream(), batch_data.size());
+  tape::tape out(std::stringstream(), existing_data.size() + batch_data.size());
+  auto tmps = make_tapes(std::vector<std::stringstream>(4), batch_data.size());
+  tape::helpers::vec_to_tape(existing_data, existing);
+  existing.seek(-existing_data.size());
+  tape::helpers::vec_to_tape(batch_data, batch);
+  batch.seek(-batch_data.size());
+
+  EXPECT_EQ(tape::merge_batch(existing, batch, out, std::span(tmps), chunk_size, compare),
+            existing_data.size() + batch_data.size());
+  EXPECT_TRUE(existing.is_begin());
+  EXPECT_TRUE(batch.is_begin());
+  for (auto& tmp : tmps) {
+    EXPECT_TRUE(tmp.is_begin());
+  }
+
+  std::vector<int32_t> expected = existing_data;
+  expected.insert(expected.end(), batch_data.begin(), batch_data.end());
+  auto result = tape::helpers::tape_to_vec(out, expected.size());
+  std::reverse(result.begin(), result.end());
+  out.seek(expected.size());
+  expect_sorted(out, expected, compare);
+  return result;
+}
+
+TEST(incremental_sorter_tests, merge_batch) {
+  // the existing elements are even and the batch ones are odd, the comparator sees only a few keys of them
+  static std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<int32_t> distribution(0, 1 << 20);
+  const tape::by_key compare([](const int32_t v) { return (v >> 1) % 7; });
+
+  for (const size_t chunk : chunk_sizes(N, 3)) {
+    std::vector<int32_t> existing(N / 2);
+    std::vector<int32_t> batch(N / 2);
+    for (auto& v : existing) {
+      v = distribution(gen) * 2;
+    }
+    for (auto& v : batch) {
+      v = distribution(gen) * 2 + 1;
+    }
+
+    const auto result = merge_batch_test(existing, batch, chunk, compare);
+    for (size_t i = 1; i < result.size(); ++i) {
+      if (!compare(result[i - 1], result[i])) {
+        // among the equivalent elements the existing ones are put first
+        EXPECT_FALSE(result[i - 1] % 2 == 1 && result[i] % 2 == 0);
+      }
+    }
+
+    EXPECT_EQ(merge_batch_test({}, batch, chunk, compare).size(), batch.size());
+    EXPECT_EQ(merge_batch_test(existing, {}, chunk, compare).size(), existing.size());
+  }
+}
+
+TEST(incremental_sorter_tests, merge_batch_unsorted) {
+  const std::vector<int32_t> existing_data{3, 1, 2};
+  tape::tape existing(std::stringstream(), existing_data.size());
+  tape::tape batch(std::stringstream(), 0);
+  tape::tape out(std::stringstream(), existing_data.size());
+  tape::helpers::vec_to_tape(existing_data, existing);
+  existing.seek(-existing_data.size());
+
+  auto tmps = make_tapes(std::vector<std::stringstream>(4), 1);
+  EXPECT_THROW(tape::merge_batch(existing, batch, out, std::span(tmps)), tape::unsorted_exception);
+  EXPECT_TRUE(existing.is_begin());
+  // the batch fits in memory, so no temporary tapes are needed
+  EXPECT_THROW(tape::merge_batch(existing, batch, out, std::span(tmps).subspan(4)), tape::unsorted_exception);
+  EXPECT_TRUE(existing.is_begin());
+
+  tape::tape large_batch(std::stringstream(), 1);
+  EXPECT_THROW(tape::merge_batch(existing, large_batch, out, std::span(tmps).subspan(1)), std::invalid_argument);
+}
+
+TEST(incremental_sorter_tests, append_batch) {
+  for (const size_t chunk : chunk_sizes(N, 3)) {
+    auto data = gen_data<N>();
+    std::sort(data.begin(), data.end());
+    const std::vector<int32_t> existing_data(data.begin(), data.begin() + N / 2);
+    std::vector<int32_t> batch_data(data.begin() + N / 2, data.end());
+    std::shuffle(batch_data.begin(), batch_data.end(), std::mt19937(std::random_device{}()));
+
+    tape::tape existing(std::stringstream(), N);
+    tape::tape batch(std::stringstream(), batch_data.size());
+    auto tmps = make_tapes(std::vector<std::stringstream>(3), batch_data.size());
+    tape::helpers::vec_to_tape(existing_data, existing);
+    tape::helpers::vec_to_tape(batch_data, batch);
+    batch.seek(-batch_data.size());
+
+    // the batch with the element less than the last existing one is not put
+    tape::tape smaller(std::stringstream(), 2);
+    tape::helpers::vec_to_tape({data[N - 1], data[N / 2 - 1] - 1}, smaller);
+    smaller.seek(-2);
+    EXPECT_FALSE(tape::append_batch(existing, smaller, std::span(tmps), chunk));
+    EXPECT_TRUE(smaller.is_begin());
+
+    EXPECT_TRUE(tape::append_batch(existing, batch, std::span(tmps), chunk));
+    EXPECT_TRUE(existing.is_end());
+    EXPECT_TRUE(batch.is_begin());
+    expect_sorted(existing, std::vector<int32_t>(data.begin(), data.end()), std::less<int32_t>());
+
+    tape::tape empty(std::stringstream(), N);
+    EXPECT_TRUE(tape::append_batch(empty, batch, std::span(tmps), chunk));
+    expect_sorted(empty, batch_data, std::less<int32_t>());
+  }
+}
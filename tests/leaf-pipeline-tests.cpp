@@ -0,0 +1,58 @@
+#include "../lib/include/leaf-pipeline.h"
+#include "helpers.h"
+
+constexpr size_t N = 1000;
+
+TEST(leaf_pipeline_tests, order) {
+  const auto data = gen_data<N>();
+  tape::tape out(std::stringstream(), N + 16);
+  {
+    tape::helpers::leaf_pipeline pipeline(out, cmp, 100, 1);
+    for (size_t i = 0; i < N; i += 100) {
+      pipeline.reserve(100);
+      pipeline.submit(static_cast<int32_t>(i), i / 100 % 4,
+                      std::vector<int32_t>(data.begin() + i, data.begin() + i + 100));
+    }
+    pipeline.submit(-1, 3, {}, true);
+    pipeline.wait();
+  }
+  EXPECT_TRUE(out.is_end());
+
+  std::vector<int32_t> expected;
+  for (size_t i = 0; i < N; i += 100) {
+    expected.insert(expected.end(), i / 100 % 4, static_cast<int32_t>(i));
+    std::vector<int32_t> leaf(data.begin() + i, data.begin() + i + 100);
+    std::sort(leaf.begin(), leaf.end());
+    expected.insert(expected.end(), leaf.begin(), leaf.end());
+  }
+  expected.insert(expected.end(), 3, -1);
+
+  auto written = tape::helpers::tape_to_vec(out, expected.size());
+  std::reverse(written.begin(), written.end());
+  EXPECT_EQ(written, expected);
+}
+
+TEST(leaf_pipeline_tests, budget) {
+  tape::tape out(std::stringstream(), 2 * N);
+  tape::helpers::leaf_pipeline pipeline(out, cmp, 100, 1);
+
+  // all the free memory is reserved
+  pipeline.reserve(10);
+  EXPECT_EQ(pipeline.reserved(), 100);
+  pipeline.submit(0, 0, std::vector<int32_t>(40, 1));
+  EXPECT_EQ(pipeline.reserved(), 60);
+  pipeline.release();
+  EXPECT_EQ(pipeline.reserved(), 0);
+  pipeline.wait();
+
+  // the leaf, which exceeds the budget, is reserved when the pipeline is empty
+  pipeline.reserve(N);
+  EXPECT_EQ(pipeline.reserved(), N);
+  pipeline.submit(0, 0, std::vector<int32_t>(N, 2));
+  EXPECT_EQ(pipeline.reserved(), 0);
+  pipeline.reserve(1);
+  EXPECT_EQ(pipeline.reserved(), 100);
+  pipeline.submit(0, 0, std::vector<int32_t>(N - 40, 3));
+  pipeline.wait();
+  EXPECT_TRUE(out.is_end());
+}
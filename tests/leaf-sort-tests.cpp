@@ -0,0 +1,171 @@
+#include "../lib/include/leaf-sort.h"
+#include "helpers.h"
+
+template <typename Compare>
+void leaf_sort_test(std::vector<int32_t> data, Compare compare, const size_t threads = 1) {
+  auto expected = data;
+  std::sort(expected.begin(), expected.end(), compare);
+  tape::helpers::sort_leaf(data, compare, std::numeric_limits<size_t>::max(), threads);
+  EXPECT_EQ(data, expected);
+}
+
+TEST(leaf_sort_tests, sort) {
+  static std::mt19937 gen(std::random_device{}());
+  for (size_t size = 0; size < 300; size += size < 40 ? 1 : 17) {
+    for (const int32_t range : {2, 100, std::numeric_limits<int32_t>::max()}) {
+      std::uniform_int_distribution<int32_t> distribution(-range, range);
+      std::vector<int32_t> data(size);
+      for (auto& v : data) {
+        v = distribution(gen);
+      }
+      if (size > 2) {
+        data[0] = std::numeric_limits<int32_t>::min();
+        data[1] = std::numeric_limits<int32_t>::max();
+      }
+
+      leaf_sort_test(data, std::less<int32_t>());
+      leaf_sort_test(data, std::greater<int32_t>());
+      leaf_sort_test(data, cmp);
+
+      std::sort(data.begin(), data.end());
+      leaf_sort_test(data, std::less<int32_t>());
+      leaf_sort_test(data, std::greater<int32_t>());
+    }
+  }
+}
+
+TEST(leaf_sort_tests, large) {
+  const auto data = gen_data<100000>();
+  leaf_sort_test(std::vector<int32_t>(data.begin(), data.end()), std::less<int32_t>());
+  leaf_sort_test(std::vector<int32_t>(100000, 7), std::less<int32_t>());
+}
+
+class unsigned_less {
+public:
+  bool operator()(const int32_t l, const int32_t r) const {
+    return static_cast<uint32_t>(l) < static_cast<uint32_t>(r);
+  }
+};
+
+template <>
+class tape::radix_key<unsigned_less> {
+public:
+  static constexpr uint32_t key(const int32_t value) {
+    return static_cast<uint32_t>(value);
+  }
+};
+
+TEST(leaf_sort_tests, radix) {
+  static_assert(tape::radix_compatible<unsigned_less>);
+
+  constexpr size_t min_size = tape::helpers::LEAF_RADIX_MIN_SIZE;
+  for (const size_t size : {min_size - 1, min_size, 3 * min_size + 7}) {
+    const auto data = gen_data<3 * tape::helpers::LEAF_RADIX_MIN_SIZE + 7>();
+    std::vector<int32_t> vec(data.begin(), data.begin() + size);
+    leaf_sort_test(vec, std::less<int32_t>());
+    leaf_sort_test(vec, std::greater<int32_t>());
+    leaf_sort_test(vec, unsigned_less());
+
+    // the high digits are the same for all the keys, so they are skipped
+    for (auto& v : vec) {
+      v &= 0xFFFF;
+    }
+    leaf_sort_test(vec, std::less<int32_t>());
+    leaf_sort_test(vec, unsigned_less());
+
+    auto sorted = vec;
+    tape::helpers::lsd_radix_sort<unsigned_less>(sorted);
+    EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end(), unsigned_less()));
+  }
+}
+
+TEST(leaf_sort_tests, radix_scratch) {
+  const auto data = gen_data<2 * tape::helpers::LEAF_RADIX_MIN_SIZE>();
+  for (const size_t scratch_size : {size_t{0}, data.size() - 1, data.size()}) {
+    std::vector<int32_t> vec(data.begin(), data.end());
+    auto expected = vec;
+    std::sort(expected.begin(), expected.end(), unsigned_less());
+    tape::helpers::sort_leaf(vec, unsigned_less(), scratch_size);
+    EXPECT_EQ(vec, expected);
+  }
+}
+
+/**
+ * Key, which counts its live instances, so the peak count of the cached keys is known.
+ */
+class counted_key {
+private:
+  int32_t value_;
+
+public:
+  static inline std::atomic<size_t> live = 0;
+  static inline std::atomic<size_t> peak = 0;
+
+  explicit counted_key(const int32_t value) : value_(value) {
+    add();
+  }
+
+  counted_key(const counted_key& other) : value_(other.value_) {
+    add();
+  }
+
+  counted_key& operator=(const counted_key& other) = default;
+
+  ~counted_key() {
+    --live;
+  }
+
+  auto operator<=>(const counted_key& other) const {
+    return value_ <=> other.value_;
+  }
+
+  bool operator==(const counted_key& other) const = default;
+
+private:
+  static void add() {
+    const size_t current = ++live;
+    for (size_t last = peak; current > last && !peak.compare_exchange_weak(last, current);) {
+    }
+  }
+};
+
+TEST(leaf_sort_tests, parallel_keyed_scratch) {
+  const auto data = gen_data<8 * tape::helpers::PARALLEL_MIN_SIZE>();
+  constexpr size_t THREADS = 4;
+  tape::by_key compare([](const int32_t v) { return counted_key(v % 1000); });
+  const size_t entry_size = tape::helpers::cached_keys_size<decltype(compare)>(1);
+  for (const size_t scratch_size : {data.size(), 4 * data.size()}) {
+    std::vector<int32_t> vec(data.begin(), data.end());
+    counted_key::peak = 0;
+    tape::helpers::sort_leaf(vec, compare, scratch_size, THREADS);
+    EXPECT_TRUE(std::is_sorted(vec.begin(), vec.end(), compare));
+    // the keys of the comparisons and the pivots of the sorts are not counted against the scratch
+    EXPECT_LE(counted_key::peak * entry_size, scratch_size + 16 * THREADS * entry_size);
+  }
+  // the cached keys of the parts fit in the scratch of the threads
+  EXPECT_GT(counted_key::peak, data.size() / 8);
+}
+
+TEST(leaf_sort_tests, parallel) {
+  const auto data = gen_data<8 * tape::helpers::PARALLEL_MIN_SIZE>();
+  constexpr size_t THREADS = 4;
+  for (const auto& cmp : comps) {
+    // the order of the equivalent elements is not defined, so the result is checked for being sorted
+    std::vector<int32_t> vec(data.begin(), data.end());
+    tape::helpers::sort_leaf(vec, cmp, std::numeric_limits<size_t>::max(), THREADS);
+    EXPECT_TRUE(std::is_sorted(vec.begin(), vec.end(), cmp));
+    std::sort(vec.begin(), vec.end());
+    std::vector<int32_t> expected(data.begin(), data.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(vec, expected);
+  }
+  leaf_sort_test(std::vector<int32_t>(data.begin(), data.end()), std::less<int32_t>(), THREADS);
+  leaf_sort_test(std::vector<int32_t>(data.begin(), data.end()), std::greater<int32_t>(), THREADS);
+  leaf_sort_test(std::vector<int32_t>(data.size(), 7), std::less<int32_t>(), THREADS);
+
+  std::vector<int32_t> vec(data.begin(), data.end());
+  auto expected = vec;
+  std::sort(expected.begin(), expected.end(), unsigned_less());
+  tape::helpers::sort_leaf(vec, unsigned_less(), vec.size() / 2, THREADS);
+  EXPECT_EQ(vec, expected);
+}
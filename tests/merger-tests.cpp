@@ -0,0 +1,191 @@
+#include "../lib/include/merger.h"
+#include "helpers.h"
+
+#include <bit>
+
+constexpr size_t N = 100;
+
+class vector_source {
+private:
+  std::vector<int32_t> data_;
+  size_t pos_ = 0;
+
+public:
+  explicit vector_source(std::vector<int32_t> data) : data_(std::move(data)) {}
+
+  [[nodiscard]] bool empty() const {
+    return pos_ == data_.size();
+  }
+
+  int32_t read() {
+    return data_[pos_++];
+  }
+};
+
+template <typename Compare>
+std::vector<std::vector<int32_t>> gen_runs(const size_t k, Compare compare) {
+  static std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<size_t> distribution(0, N);
+
+  std::vector<std::vector<int32_t>> runs;
+  for (size_t i = 0; i < k; ++i) {
+    const auto data = gen_data<N>();
+    std::vector<int32_t> run(data.begin(), data.begin() + distribution(gen));
+    std::sort(run.begin(), run.end(), compare);
+    runs.push_back(std::move(run));
+  }
+  return runs;
+}
+
+TEST(merger_tests, loser_tree) {
+  for (size_t k = 0; k < 20; ++k) {
+    for (const auto& cmp : comps) {
+      const auto runs = gen_runs(k, cmp);
+      std::vector<vector_source> sources;
+      std::vector<int32_t> expected;
+      for (const auto& run : runs) {
+        sources.emplace_back(run);
+        expected.insert(expected.end(), run.begin(), run.end());
+      }
+
+      tape::helpers::loser_tree tree(std::move(sources), cmp);
+      std::vector<int32_t> result;
+      while (!tree.empty()) {
+        const int32_t top = tree.top();
+        EXPECT_EQ(top, tree.pop());
+        result.push_back(top);
+      }
+
+      for (size_t i = 1; i < result.size(); ++i) {
+        EXPECT_FALSE(cmp(result[i], result[i - 1]));
+      }
+      std::sort(result.begin(), result.end());
+      std::sort(expected.begin(), expected.end());
+      EXPECT_EQ(result, expected);
+    }
+  }
+}
+
+TEST(merger_tests, loser_tree_stability) {
+  constexpr int32_t K = 10;
+  const auto key_cmp = [](const int32_t l, const int32_t r) { return l / K < r / K; };
+
+  std::vector<vector_source> sources;
+  for (int32_t i = 0; i < K; ++i) {
+    std::vector<int32_t> run;
+    for (int32_t key = 0; key < 10; ++key) {
+      run.push_back(key * K + i);
+    }
+    sources.emplace_back(std::move(run));
+  }
+
+  tape::helpers::loser_tree tree(std::move(sources), key_cmp);
+  for (int32_t expected = 0; !tree.empty(); ++expected) {
+    EXPECT_EQ(tree.pop(), expected);
+  }
+}
+
+TEST(merger_tests, loser_tree_comparisons) {
+  for (size_t k = 1; k < 64; k = 2 * k + 1) {
+    size_t comparisons = 0;
+    const auto counting_cmp = [&comparisons](const int32_t l, const int32_t r) {
+      ++comparisons;
+      return l < r;
+    };
+
+    std::vector<vector_source> sources;
+    size_t size = 0;
+    for (const auto& run : gen_runs(k, cmp)) {
+      sources.emplace_back(run);
+      size += run.size();
+    }
+
+    tape::helpers::loser_tree tree(std::move(sources), counting_cmp);
+    while (!tree.empty()) {
+      tree.pop();
+    }
+    const size_t height = std::bit_width(k);
+    EXPECT_LE(comparisons, k + size * height);
+  }
+}
+
+template <typename T, typename TOut, typename Compare>
+void merge_runs_test(std::vector<T> streams, TOut out_stream, Compare compare) {
+  const auto runs = gen_runs(streams.size(), compare);
+  auto tapes = make_tapes(std::move(streams), N);
+  std::vector<tape::helpers::run_reader<T>> sources;
+  std::vector<int32_t> expected;
+  for (size_t i = 0; i < tapes.size(); ++i) {
+    // the runs are peeked, so they are put in the reversed order
+    tape::helpers::vec_to_tape(std::vector(runs[i].rbegin(), runs[i].rend()), tapes[i]);
+    sources.emplace_back(tapes[i], runs[i].size());
+    expected.insert(expected.end(), runs[i].begin(), runs[i].end());
+  }
+
+  tape::tape out(std::move(out_stream), N * tapes.size());
+  EXPECT_EQ(tape::helpers::merge_runs(std::move(sources), out, compare), expected.size());
+  for (auto& tp : tapes) {
+    EXPECT_TRUE(tp.is_begin());
+  }
+  expect_sorted(out, expected, compare);
+}
+
+TEST(merger_tests, merge_runs) {
+  const file_guard fout(get_file_name("out"));
+  for (size_t k = 0; k <= 8; ++k) {
+    for (const auto& cmp : comps) {
+      merge_runs_test(std::vector<std::stringstream>(k), std::stringstream(), cmp);
+
+      std::vector<file_guard> guards;
+      merge_runs_test(tmp_streams(guards, k, "run"), std::fstream(fout.path()), cmp);
+    }
+  }
+}
+
+TEST(merger_tests, merge) {
+  for (const auto& cmp : comps) {
+    for (size_t k = 0; k <= 6; ++k) {
+      for (const size_t chunk : {size_t{0}, size_t{1}, size_t{7}, N}) {
+        std::vector<tape::tape<std::stringstream>> ins;
+        std::vector<int32_t> expected;
+        for (size_t i = 0; i < k; ++i) {
+          const auto data = gen_data<N>();
+          std::vector<int32_t> run(data.begin(), data.begin() + static_cast<ptrdiff_t>(i * N / 6));
+          std::sort(run.begin(), run.end(), cmp);
+          expected.insert(expected.end(), run.begin(), run.end());
+
+          ins.emplace_back(std::stringstream(), run.size());
+          tape::helpers::vec_to_tape(run, ins.back());
+          ins.back().seek(-run.size());
+        }
+
+        tape::tape out(std::stringstream(), expected.size());
+        EXPECT_EQ(tape::merge(std::span(ins), out, chunk, cmp), expected.size());
+        for (auto& tp : ins) {
+          EXPECT_TRUE(tp.is_begin());
+        }
+        expect_sorted(out, expected, cmp);
+      }
+    }
+  }
+}
+
+TEST(merger_tests, merge_unsorted) {
+  std::vector<tape::tape<std::stringstream>> ins;
+  for (const auto& run : {std::vector<int32_t>{1, 3, 5}, std::vector<int32_t>{2, 6, 4, 8}}) {
+    ins.emplace_back(std::stringstream(), run.size());
+    tape::helpers::vec_to_tape(run, ins.back());
+    ins.back().seek(-run.size());
+  }
+
+  tape::tape out(std::stringstream(), 7);
+  try {
+    tape::merge(std::span(ins), out, 2);
+    FAIL() << "unsorted_exception expected";
+  } catch (const tape::unsorted_exception& e) {
+    EXPECT_EQ(std::string(e.what()), "the input tape 1 is not sorted at the element 2");
+  }
+  for (const auto& in : ins) {
+    EXPECT_TRUE(in.is_begin());
+  }
+}
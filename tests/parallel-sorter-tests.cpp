@@ -0,0 +1,90 @@
+#include "../lib/include/parallel-sorter.h"
+#include "helpers.h"
+
+#include <bit>
+
+constexpr size_t N = 100;
+
+template <typename T, typename Compare>
+void parallel_test(std::vector<std::vector<T>> set_streams, const std::vector<int32_t>& data,
+                   const size_t chunk_size, Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  std::vector<std::vector<tape::tape<T>>> sets;
+  for (auto& streams : set_streams) {
+    sets.push_back(make_tapes(std::move(streams), data.size()));
+  }
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::parallel_sort(in, out, std::span(sets), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  for (auto& set : sets) {
+    for (auto& tmp : set) {
+      EXPECT_TRUE(tmp.is_begin());
+    }
+  }
+  expect_sorted(out, data, compare);
+}
+
+TEST(parallel_sorter_tests, partitions) {
+  // each of the bit_floor(sets) partitions is sorted on its own set, so the tapes of the set are read, and the other
+  // sets are not used. The partitions are split by the quantiles of the sample, so each one takes a fair share
+  constexpr size_t M = 20000;
+  const auto data = gen_data<M>();
+  const std::vector<int32_t> vec(data.begin(), data.end());
+  for (size_t sets = 1; sets < 6; ++sets) {
+    for (const auto& cmp : {comps[0], comps[1], comps[3]}) {
+      std::vector<size_t> reads(sets);
+      std::vector<std::vector<counting_stream>> streams(sets);
+      for (size_t set = 0; set < sets; ++set) {
+        for (size_t i = 0; i < tape::helpers::PARALLEL_SET_SIZE; ++i) {
+          streams[set].emplace_back(reads[set]);
+        }
+      }
+      parallel_test(std::move(streams), vec, 100, cmp);
+
+      const size_t used = std::bit_floor(sets);
+      for (size_t set = 0; set < sets; ++set) {
+        if (set < used) {
+          EXPECT_GE(reads[set], M / used / 4);
+        } else {
+          EXPECT_EQ(reads[set], 0);
+        }
+      }
+    }
+  }
+
+  // all the quantiles of the equal elements are the same, so the partitions are uneven
+  for (size_t sets = 1; sets < 6; ++sets) {
+    std::vector<std::vector<std::stringstream>> streams(sets);
+    for (auto& set : streams) {
+      set.resize(tape::helpers::PARALLEL_SET_SIZE);
+    }
+    parallel_test(std::move(streams), std::vector<int32_t>(N, 7), 10, cmp);
+  }
+}
+
+TEST(parallel_sorter_tests, invalid_sets) {
+  tape::tape in(std::stringstream(), N);
+  tape::tape out(std::stringstream(), N);
+  std::vector<std::vector<tape::tape<std::stringstream>>> sets;
+  EXPECT_THROW(tape::parallel_sort(in, out, std::span(sets)), std::invalid_argument);
+
+  sets.emplace_back();
+  for (size_t i = 0; i < 4; ++i) {
+    sets.back().emplace_back(std::stringstream(), N);
+  }
+  EXPECT_THROW(tape::parallel_sort(in, out, std::span(sets)), std::invalid_argument);
+}
+
+TEST(parallel_sorter_tests, files) {
+  std::vector<file_guard> guards;
+  std::vector<std::vector<std::fstream>> streams;
+  for (size_t i = 0; i < 2; ++i) {
+    streams.push_back(tmp_streams(guards, 5, "tmp" + std::to_string(i) + "_"));
+  }
+
+  const auto data = gen_data<N>();
+  parallel_test(std::move(streams), std::vector<int32_t>(data.begin(), data.end()), 0, cmp);
+}
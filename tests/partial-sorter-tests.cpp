@@ -0,0 +1,106 @@
+#include "../lib/include/partial-sorter.h"
+#include "helpers.h"
+
+#include <numeric>
+
+constexpr size_t N = 300;
+
+/**
+ * Checks that the @code std::min(k, data.size())@endcode elements before the @code out@endcode head are
+ * the elements of @code data@endcode equivalent to its @code k@endcode least elements in the sorted order.
+ */
+template <typename Stream, typename Compare>
+void expect_least(tape::tape<Stream>& out, std::vector<int32_t> data, const size_t k, Compare compare) {
+  const size_t size = std::min(k, data.size());
+  auto result = tape::helpers::tape_to_vec(out, size);
+  ASSERT_EQ(result.size(), size);
+  std::reverse(result.begin(), result.end());
+
+  std::sort(data.begin(), data.end(), compare);
+  for (size_t i = 0; i < size; ++i) {
+    EXPECT_FALSE(compare(result[i], data[i]) || compare(data[i], result[i]));
+  }
+
+  std::sort(result.begin(), result.end());
+  std::sort(data.begin(), data.end());
+  EXPECT_TRUE(std::includes(data.begin(), data.end(), result.begin(), result.end()));
+}
+
+template <typename Compare>
+void partial_test(const std::vector<int32_t>& data, const size_t k, const size_t chunk_size, Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  tape::tape tmp1(std::stringstream(), data.size());
+  tape::tape tmp2(std::stringstream(), data.size());
+  tape::tape tmp3(std::stringstream(), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::partial_sort(in, out, k, tmp1, tmp2, tmp3, chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  EXPECT_TRUE(tmp1.is_begin());
+  EXPECT_TRUE(tmp2.is_begin());
+  EXPECT_TRUE(tmp3.is_begin());
+  expect_least(out, data, k, compare);
+}
+
+TEST(partial_sorter_tests, boundary) {
+  // runs of the equal elements, so the rank k falls inside a run, at its first or at its last element
+  constexpr size_t RUN = 7;
+  std::vector<int32_t> data(N);
+  for (size_t i = 0; i < N; ++i) {
+    data[i] = static_cast<int32_t>(i / RUN);
+  }
+  std::shuffle(data.begin(), data.end(), std::mt19937(std::random_device{}()));
+
+  for (const size_t k : {RUN - 1, RUN, RUN + 1, 5 * RUN, N / 2, N - 1, N, N + 5}) {
+    for (const size_t chunk : {size_t{0}, size_t{1}, RUN, k, N}) {
+      partial_test(data, k, chunk, cmp);
+      partial_test(data, k, chunk, rev_cmp);
+      partial_test(data, k, chunk, mod_cmp<239>);
+    }
+  }
+  partial_test(data, 0, 10, cmp);
+  partial_test(std::vector<int32_t>(N, 3), N / 2, 10, cmp);
+}
+
+TEST(partial_sorter_tests, passes) {
+  constexpr size_t M = 100000;
+  std::vector<int32_t> data(M);
+  std::iota(data.begin(), data.end(), 0);
+  std::shuffle(data.begin(), data.end(), std::mt19937(std::random_device{}()));
+
+  size_t reads = 0;
+  tape::tape in(std::stringstream(), M);
+  tape::tape out(std::stringstream(), M);
+  tape::tape tmp1(counting_stream(reads), M);
+  tape::tape tmp2(counting_stream(reads), M);
+  tape::tape tmp3(counting_stream(reads), M);
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-M);
+
+  // the heap of k elements selects them in a single pass over the input
+  tape::partial_sort(in, out, 100, tmp1, tmp2, tmp3, 100);
+  EXPECT_EQ(reads, 0);
+  EXPECT_TRUE(in.is_begin());
+  expect_least(out, data, 100, std::less<int32_t>());
+
+  // only the parts with the least elements are split after the first split, so the parts shrink geometrically
+  // instead of the log(M / chunk_size) passes of the full sort
+  tape::partial_sort(in, out, 1000, tmp1, tmp2, tmp3, 100);
+  EXPECT_LE(reads, 2 * M);
+  EXPECT_TRUE(in.is_begin());
+  expect_least(out, data, 1000, std::less<int32_t>());
+}
+
+TEST(partial_sorter_tests, large) {
+  constexpr size_t M = 100000;
+  std::vector<int32_t> data(M);
+  std::mt19937 gen(std::random_device{}());
+  std::generate(data.begin(), data.end(), [&gen] { return static_cast<int32_t>(gen()); });
+
+  for (const size_t k : {size_t{100}, M / 100, M / 2}) {
+    partial_test(data, k, 1000, std::less<int32_t>());
+    partial_test(data, k, 1000, std::greater<int32_t>());
+  }
+}
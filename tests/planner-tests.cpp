@@ -0,0 +1,183 @@
+#include "../lib/include/adaptive-sorter.h"
+#include "helpers.h"
+
+constexpr size_t N = 100;
+
+template <typename Compare>
+tape::helpers::presortedness<Compare> get_stats(const std::vector<int32_t>& data, Compare compare,
+                                                const size_t counts_limit = N) {
+  tape::helpers::presortedness<Compare> stats(compare, counts_limit);
+  for (const auto v : data) {
+    stats.update(v);
+  }
+  return stats;
+}
+
+TEST(planner_tests, presortedness) {
+  const auto sorted = get_stats({1, 2, 2, 3, 5}, cmp);
+  EXPECT_TRUE(sorted.sorted());
+  EXPECT_FALSE(sorted.reverse_sorted());
+  EXPECT_EQ(sorted.runs(), 1);
+  EXPECT_EQ(sorted.min(), 1);
+  EXPECT_EQ(sorted.max(), 5);
+  EXPECT_TRUE(sorted.counted());
+  EXPECT_DOUBLE_EQ(sorted.duplicates(), 0.2);
+
+  const auto reversed = get_stats({5, 3, 3, 1}, cmp);
+  EXPECT_FALSE(reversed.sorted());
+  EXPECT_TRUE(reversed.reverse_sorted());
+  EXPECT_EQ(reversed.runs(), 2);
+
+  const auto runs = get_stats({1, 2, 3, 0, 4, 5, 3, 2, 1, 7}, cmp);
+  EXPECT_EQ(runs.runs(), 4);
+  EXPECT_EQ(runs.descents(), 4);
+  EXPECT_EQ(runs.min(), 0);
+  EXPECT_EQ(runs.max(), 7);
+
+  const auto equal = get_stats({3, 5, 7, 1}, mod_cmp<2>);
+  EXPECT_TRUE(equal.sorted());
+  EXPECT_TRUE(equal.reverse_sorted());
+  EXPECT_EQ(equal.counts().size(), 4);
+
+  const auto overflow = get_stats({1, 2, 3, 4, 1, 2}, cmp, 2);
+  EXPECT_FALSE(overflow.counted());
+  EXPECT_TRUE(overflow.counts().empty());
+  EXPECT_EQ(overflow.size(), 6);
+
+  std::vector<int32_t> repeated(1000);
+  for (size_t i = 0; i < repeated.size(); ++i) {
+    repeated[i] = static_cast<int32_t>(i * 7 % 10);
+  }
+  const auto merged = get_stats(repeated, cmp, 20);
+  EXPECT_TRUE(merged.counted());
+  ASSERT_EQ(merged.counts().size(), 10);
+  for (size_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(merged.counts()[i], std::make_pair(static_cast<int32_t>(i), 100u));
+  }
+}
+
+TEST(planner_tests, choose_strategy) {
+  EXPECT_EQ(tape::choose_strategy(get_stats({}, cmp), 0, true), tape::strategy::copy);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 2, 3}, cmp), 0, true), tape::strategy::copy);
+  EXPECT_EQ(tape::choose_strategy(get_stats({3, 2, 1}, cmp), 0, true), tape::strategy::reverse);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 3, 2}, cmp), 0, true), tape::strategy::counting);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 3, 2, 4}, cmp, 2), 10, true), tape::strategy::memory);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 3, 2, 4}, cmp, 2), 2, true), tape::strategy::merge);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 3, 2, 4}, cmp, 2), 2, false), tape::strategy::quick);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 3, 2, 4, 3, 5}, cmp, 2), 3, true), tape::strategy::radix);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 3, 2, 4, 3, 5}, comps[0], 2), 3, true), tape::strategy::quick);
+}
+
+/**
+ * @return count of the elements read from the temporary tapes by the @code sort()@endcode of @code data@endcode.
+ */
+template <typename Compare>
+size_t adaptive_test(const std::vector<int32_t>& data, const size_t chunk_size, Compare compare) {
+  size_t reads = 0;
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  std::vector<tape::tape<counting_stream>> tmps;
+  for (size_t i = 0; i < 4; ++i) {
+    tmps.emplace_back(counting_stream(reads), data.size());
+  }
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::sort(in, out, std::span(tmps), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  for (auto& tmp : tmps) {
+    EXPECT_TRUE(tmp.is_begin());
+  }
+  expect_sorted(out, data, compare);
+  return reads;
+}
+
+template <typename Compare>
+void five_tapes_test(const std::vector<int32_t>& data, const size_t chunk_size, Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  tape::tape tmp1(std::stringstream(), data.size());
+  tape::tape tmp2(std::stringstream(), data.size());
+  tape::tape tmp3(std::stringstream(), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::sort(in, out, tmp1, tmp2, tmp3, chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  EXPECT_TRUE(tmp1.is_begin());
+  EXPECT_TRUE(tmp2.is_begin());
+  EXPECT_TRUE(tmp3.is_begin());
+  expect_sorted(out, data, compare);
+}
+
+TEST(planner_tests, strategies) {
+  for (size_t c = 0; c < comps.size(); ++c) {
+    const auto& cmp = comps[c];
+    const auto data = gen_datasets<N>(5);
+    std::vector<int32_t> sorted = data.random;
+    std::sort(sorted.begin(), sorted.end(), cmp);
+    std::vector<int32_t> reversed(sorted.rbegin(), sorted.rend());
+    std::vector<int32_t> runs = sorted;
+    std::reverse(runs.begin() + N / 2, runs.end());
+
+    for (size_t chunk = 0; chunk <= N; chunk += 25) {
+      // the sorted data is copied forward or backward, so the temporary tapes are not used
+      EXPECT_EQ(adaptive_test(sorted, chunk, cmp), 0);
+      EXPECT_EQ(adaptive_test(reversed, chunk, cmp), 0);
+      // the 9 distinct remainders modulo 5 are counted in memory once they surely fit in the limit of the counts
+      const size_t few_reads = adaptive_test(data.few, chunk, cmp);
+      if (chunk >= 50) {
+        EXPECT_EQ(few_reads, 0);
+      }
+      // the data, which fits in memory, is sorted there
+      const size_t random_reads = adaptive_test(data.random, chunk, cmp);
+      if (chunk >= N) {
+        EXPECT_EQ(random_reads, 0);
+      }
+      // the two runs are merged by the natural sort in a single pass. The ties of the other comparators break the
+      // descending run
+      const size_t runs_reads = adaptive_test(runs, chunk, cmp);
+      if (c < 2) {
+        EXPECT_LE(runs_reads, N);
+      }
+
+      five_tapes_test(data.random, chunk, cmp);
+      five_tapes_test(runs, chunk, cmp);
+    }
+  }
+}
+
+TEST(planner_tests, operation_counts) {
+  tape::operation_counts counts;
+  counts.add_passes(2, 10);
+  counts.add_rewinds(3, 40);
+  EXPECT_DOUBLE_EQ(counts.time({1, 10, 100, 1000, 10000}), 20 + 200 + 400000 + 3000 + 100 * 40);
+
+  // 4 passes of the quick sort split 1000 elements into the parts of 10 by 4 buckets, the last pass puts them
+  EXPECT_DOUBLE_EQ(tape::estimate_quick(1000, 10, 5).reads, 5000);
+  EXPECT_DOUBLE_EQ(tape::estimate_quick(1000, 10, 5).rewinds, 1);
+  // the distribution and a single merge of 4 runs
+  EXPECT_DOUBLE_EQ(tape::estimate_merge(1000, 4, 5).writes, 2000);
+  EXPECT_DOUBLE_EQ(tape::estimate_merge(1000, 4, 5).rewinds, 5);
+  // 3 passes by 2 bits handle 6 differing bits
+  EXPECT_DOUBLE_EQ(tape::estimate_radix(1000, 10, 5, 6).moves, 8000);
+}
+
+TEST(planner_tests, choose_strategy_delays) {
+  std::vector<int32_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<int32_t>(i % 250);
+  }
+  const auto stats = get_stats(data, comps[0], 2);
+  const tape::delay_config no_delays{};
+  const tape::delay_config fast_rewinds{1, 1, 0, 0, 1};
+  const tape::delay_config slow_rewinds{1, 1, 1000, 0, 1};
+
+  EXPECT_EQ(tape::choose_strategy(stats, 10, 5, no_delays), tape::strategy::merge);
+  EXPECT_EQ(tape::choose_strategy(stats, 10, 5, fast_rewinds), tape::strategy::merge);
+  EXPECT_EQ(tape::choose_strategy(stats, 10, 5, slow_rewinds), tape::strategy::quick);
+
+  const auto radix_stats = get_stats(data, cmp, 2);
+  EXPECT_EQ(tape::choose_strategy(radix_stats, 10, 5, slow_rewinds), tape::strategy::radix);
+  EXPECT_EQ(tape::choose_strategy(get_stats({1, 3, 2, 4}, cmp, 2), 10, 5, slow_rewinds), tape::strategy::memory);
+}
@@ -0,0 +1,268 @@
+#include "../lib/include/polyphase.h"
+#include "helpers.h"
+
+#include <numeric>
+
+constexpr size_t N = 100;
+
+TEST(polyphase_tests, distribution) {
+  EXPECT_EQ(tape::helpers::polyphase_distribution(2, 1), std::vector<size_t>({1, 0}));
+  EXPECT_EQ(tape::helpers::polyphase_distribution(2, 7), std::vector<size_t>({5, 3}));
+  EXPECT_EQ(tape::helpers::polyphase_distribution(2, 8), std::vector<size_t>({5, 3}));
+  EXPECT_EQ(tape::helpers::polyphase_distribution(3, 9), std::vector<size_t>({4, 3, 2}));
+  EXPECT_EQ(tape::helpers::polyphase_distribution(3, 10), std::vector<size_t>({7, 6, 4}));
+}
+
+TEST(polyphase_tests, plan) {
+  for (size_t tapes = 3; tapes < 7; ++tapes) {
+    for (size_t runs = 2; runs < 50; ++runs) {
+      const tape::helpers::polyphase_plan plan(tapes, runs);
+      const auto distribution = tape::helpers::polyphase_distribution(tapes - 1, runs);
+
+      std::vector<size_t> counts(tapes, 0);
+      for (const size_t i : plan.tapes) {
+        ++counts[i];
+      }
+      EXPECT_EQ(counts[tapes - 1], 0);
+      for (size_t i = 0; i + 1 < tapes; ++i) {
+        EXPECT_EQ(counts[i] + plan.dummies[i], distribution[i]);
+      }
+    }
+  }
+  EXPECT_THROW(tape::helpers::polyphase_plan(2, 10), std::invalid_argument);
+}
+
+template <typename TIn, typename TOut, typename T, typename Compare>
+void polyphase_test(TIn in_stream, TOut out_stream, std::vector<T> tmp_streams, const size_t size,
+                    const size_t chunk_size, Compare compare) {
+  tape::tape in(std::move(in_stream), size);
+  tape::tape out(std::move(out_stream), size);
+  auto tmps = make_tapes(std::move(tmp_streams), size);
+
+  const auto data = gen_data<N>();
+  const std::vector<int32_t> vec(data.begin(), data.begin() + size);
+  for (const auto v : vec) {
+    tape::helpers::put(in, v);
+  }
+  in.seek(-size);
+
+  tape::polyphase_sort(in, out, std::span(tmps), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  for (auto& tmp : tmps) {
+    EXPECT_TRUE(tmp.is_begin());
+  }
+  expect_sorted(out, vec, compare);
+}
+
+/**
+ * Count of the phases of the polyphase merge of @code runs@endcode runs from @code inputs@endcode tapes, that is the
+ * level of the smallest perfect distribution, which contains at least @code runs@endcode runs.
+ */
+size_t polyphase_phases(const size_t inputs, const size_t runs) {
+  std::vector<size_t> counts(inputs, 0);
+  counts[0] = 1;
+  size_t phases = 0;
+  while (std::accumulate(counts.begin(), counts.end(), size_t{0}) < runs) {
+    std::vector<size_t> next(inputs);
+    for (size_t i = 0; i < inputs; ++i) {
+      next[i] = counts[0] + (i + 1 < inputs ? counts[i + 1] : 0);
+    }
+    counts = std::move(next);
+    ++phases;
+  }
+  return phases;
+}
+
+TEST(polyphase_tests, passes) {
+  // each element is read from the temporary tapes no more than once in each phase of the merge
+  constexpr size_t M = 10000;
+  const auto data = gen_data<M>();
+  const std::vector<int32_t> vec(data.begin(), data.end());
+
+  for (size_t tapes = 3; tapes < 7; ++tapes) {
+    for (const size_t chunk : {M, (M + tapes - 2) / (tapes - 1), M / 10, M / 100, size_t{10}}) {
+      size_t reads = 0;
+      tape::tape in(std::stringstream(), M);
+      tape::tape out(std::stringstream(), M);
+      std::vector<counting_stream> streams;
+      for (size_t i = 0; i < tapes; ++i) {
+        streams.emplace_back(reads);
+      }
+      auto tmps = make_tapes(std::move(streams), M);
+      tape::helpers::vec_to_tape(vec, in);
+      in.seek(-M);
+
+      tape::polyphase_sort(in, out, std::span(tmps), chunk, cmp);
+      expect_sorted(out, vec, cmp);
+
+      const size_t runs = (M + chunk - 1) / chunk;
+      if (runs == 1) {
+        EXPECT_EQ(reads, 0);
+      } else if (runs < tapes) {
+        // a single merge puts the runs to the output
+        EXPECT_EQ(reads, M);
+      } else {
+        EXPECT_LE(reads, polyphase_phases(tapes - 1, runs) * M);
+      }
+    }
+  }
+}
+
+TEST(polyphase_tests, sizes) {
+  const file_guard fin(get_file_name("in"));
+  const file_guard fout(get_file_name("out"));
+
+  for (size_t size = 0; size < N; ++size) {
+    polyphase_test(std::stringstream(), std::stringstream(), std::vector<std::stringstream>(3), size, 3, cmp);
+    polyphase_test(std::stringstream(), std::stringstream(), std::vector<std::stringstream>(4), size, 1, rev_cmp);
+  }
+
+  std::vector<file_guard> guards;
+  polyphase_test(std::fstream(fin.path()), std::fstream(fout.path()), tmp_streams(guards, 5), N, 7, mod_cmp<239>);
+}
+
+TEST(polyphase_tests, few_tapes) {
+  std::vector<tape::tape<std::stringstream>> tmps;
+  tmps.emplace_back(std::stringstream(), N);
+  tmps.emplace_back(std::stringstream(), N);
+
+  tape::tape in(std::stringstream(), N);
+  tape::tape out(std::stringstream(), N);
+  EXPECT_THROW(tape::polyphase_sort(in, out, std::span(tmps)), std::invalid_argument);
+}
+
+TEST(polyphase_tests, distributor) {
+  for (size_t tapes = 3; tapes < 7; ++tapes) {
+    for (size_t runs = 1; runs < 100; ++runs) {
+      tape::helpers::polyphase_distributor distributor(tapes);
+      std::vector<size_t> counts(tapes, 0);
+      for (size_t r = 0; r < runs; ++r) {
+        ++counts[distributor.next()];
+      }
+
+      for (size_t i = 0; i < tapes; ++i) {
+        counts[i] += distributor.dummies()[i];
+      }
+      EXPECT_EQ(counts[tapes - 1], 0);
+      counts.pop_back();
+      const size_t total = std::accumulate(counts.begin(), counts.end(), size_t{0});
+      EXPECT_GE(total, runs);
+      EXPECT_EQ(counts, tape::helpers::polyphase_distribution(tapes - 1, total));
+    }
+  }
+}
+
+template <typename T, typename Compare>
+void natural_test(std::vector<T> tmp_streams, std::vector<int32_t> data, Compare compare,
+                  const size_t chunk_size = 0) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  auto tmps = make_tapes(std::move(tmp_streams), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::natural_sort(in, out, std::span(tmps), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  for (auto& tmp : tmps) {
+    EXPECT_TRUE(tmp.is_begin());
+  }
+  expect_sorted(out, data, compare);
+}
+
+TEST(polyphase_tests, natural_sort) {
+  static std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<size_t> distribution(0, N - 1);
+
+  for (size_t tapes = 3; tapes < 7; ++tapes) {
+    for (const auto& cmp : comps) {
+      for (size_t swaps = 0; swaps < N; swaps = swaps * 2 + 1) {
+        const auto data = gen_data<N>();
+        std::vector<int32_t> vec(data.begin(), data.end());
+        std::sort(vec.begin(), vec.end(), cmp);
+        for (size_t i = 0; i < swaps; ++i) {
+          std::swap(vec[distribution(gen)], vec[distribution(gen)]);
+        }
+        for (const size_t chunk : chunk_sizes(N, 3)) {
+          natural_test(std::vector<std::stringstream>(tapes), vec, cmp, chunk);
+        }
+
+        std::reverse(vec.begin(), vec.end());
+        for (const size_t chunk : chunk_sizes(N, 3)) {
+          natural_test(std::vector<std::stringstream>(tapes), vec, cmp, chunk);
+        }
+      }
+    }
+    natural_test(std::vector<std::stringstream>(tapes), {}, cmp);
+    natural_test(std::vector<std::stringstream>(tapes), {1}, cmp);
+    natural_test(std::vector<std::stringstream>(tapes), {1, 1, 1, 0, 0}, cmp);
+  }
+}
+
+TEST(polyphase_tests, natural_passes) {
+  // there are no more runs than the natural runs or the blocks, and each element is read from the temporary tapes
+  // no more than once in each phase of the merge
+  constexpr size_t M = 10000;
+  static std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<size_t> distribution(0, M - 1);
+  const auto data = gen_data<M>();
+
+  const auto natural_reads = [](const std::vector<int32_t>& vec, const size_t tapes, const size_t chunk) {
+    size_t reads = 0;
+    tape::tape in(std::stringstream(), M);
+    tape::tape out(std::stringstream(), M);
+    std::vector<counting_stream> streams;
+    for (size_t i = 0; i < tapes; ++i) {
+      streams.emplace_back(reads);
+    }
+    auto tmps = make_tapes(std::move(streams), M);
+    tape::helpers::vec_to_tape(vec, in);
+    in.seek(-M);
+
+    tape::natural_sort(in, out, std::span(tmps), chunk, cmp);
+    expect_sorted(out, vec, cmp);
+    return reads;
+  };
+
+  for (size_t tapes = 3; tapes < 7; ++tapes) {
+    std::vector<int32_t> vec(data.begin(), data.end());
+    for (const size_t chunk : {size_t{10}, M / 100, M / 10}) {
+      EXPECT_LE(natural_reads(vec, tapes, chunk), polyphase_phases(tapes - 1, (M + chunk - 1) / chunk) * M);
+    }
+
+    std::sort(vec.begin(), vec.end());
+    for (size_t swaps = 0; swaps < M; swaps = swaps * 4 + 1) {
+      std::vector<int32_t> swapped = vec;
+      for (size_t i = 0; i < swaps; ++i) {
+        std::swap(swapped[distribution(gen)], swapped[distribution(gen)]);
+      }
+      // each swap breaks no more than two runs, the single run is read once
+      const size_t bound = std::max<size_t>(polyphase_phases(tapes - 1, 2 * swaps + 1), 1) * M;
+      EXPECT_LE(natural_reads(swapped, tapes, 0), bound);
+      std::reverse(swapped.begin(), swapped.end());
+      EXPECT_LE(natural_reads(swapped, tapes, 0), bound);
+    }
+  }
+}
+
+TEST(polyphase_tests, natural_descending) {
+  // the descending blocks are sorted by the leaf sort and reversed, so they continue a single descending run
+  constexpr size_t M = 10000;
+  std::vector<int32_t> data(M);
+  std::iota(data.begin(), data.end(), 0);
+  std::reverse(data.begin(), data.end());
+  const tape::by_key compare([](const int32_t v) { return static_cast<int64_t>(v) * 2; });
+
+  size_t reads = 0;
+  tape::tape in(std::stringstream(), M);
+  tape::tape out(std::stringstream(), M);
+  std::vector<tape::tape<counting_stream>> tmps;
+  for (size_t i = 0; i < 3; ++i) {
+    tmps.emplace_back(counting_stream(reads), M);
+  }
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-M);
+
+  tape::natural_sort(in, out, std::span(tmps), M / 10, compare, 2);
+  EXPECT_LE(reads, M);
+  expect_sorted(out, data, compare);
+}
@@ -0,0 +1,98 @@
+#include "../lib/include/adaptive-sorter.h"
+#include "../lib/include/projection.h"
+#include "../lib/include/sorter.h"
+#include "helpers.h"
+
+constexpr size_t N = 1000;
+
+inline auto bit_cnt_key = [](const int32_t v) { return bit_cnt(v); };
+
+inline auto mod_key = [](const int32_t v) { return v % 239; };
+
+inline auto unsigned_key = [](const int32_t v) { return static_cast<uint32_t>(v); };
+
+inline size_t projections = 0;
+
+inline auto counted_key = [](const int32_t v) {
+  ++projections;
+  return static_cast<int64_t>(v) * v;
+};
+
+TEST(projection_tests, radix_compatible) {
+  static_assert(tape::keyed<tape::by_key<decltype(mod_key)>>);
+  static_assert(!tape::keyed<std::less<int32_t>>);
+
+  static_assert(tape::radix_compatible<tape::by_key<decltype(mod_key)>>);
+  static_assert(tape::radix_compatible<tape::by_key<decltype(unsigned_key)>>);
+  static_assert(!tape::radix_compatible<tape::by_key<decltype(bit_cnt_key)>>);
+  static_assert(!tape::radix_compatible<tape::by_key<decltype(counted_key)>>);
+  static_assert(!tape::radix_compatible<tape::by_key<std::function<int32_t(int32_t)>>>);
+
+  const auto data = gen_data<N>();
+  const tape::by_key<decltype(mod_key)> compare;
+  for (size_t i = 1; i < N; ++i) {
+    using key = tape::radix_key<tape::by_key<decltype(mod_key)>>;
+    EXPECT_EQ(compare(data[i - 1], data[i]), key::key(data[i - 1]) < key::key(data[i]));
+  }
+}
+
+TEST(projection_tests, before) {
+  const auto data = gen_data<N>();
+  const tape::by_key compare(bit_cnt_key);
+  const auto to_left = tape::helpers::before(compare, data[0]);
+  for (const int32_t v : data) {
+    EXPECT_EQ(to_left(v), compare(v, data[0]));
+  }
+}
+
+TEST(projection_tests, cached_keys) {
+  const auto data = gen_data<N>();
+  const tape::by_key compare(counted_key);
+  constexpr size_t scratch = tape::helpers::cached_keys_size<tape::by_key<decltype(counted_key)>>(N);
+  EXPECT_EQ(scratch, 4 * N);
+
+  std::vector<int32_t> vec(data.begin(), data.end());
+  EXPECT_FALSE(tape::helpers::sort_cached_keys(std::span(vec), compare, scratch - 1));
+  EXPECT_TRUE(std::equal(vec.begin(), vec.end(), data.begin()));
+
+  projections = 0;
+  tape::helpers::sort_leaf(vec, compare, scratch);
+  EXPECT_EQ(projections, N);
+  EXPECT_TRUE(std::is_sorted(vec.begin(), vec.end(), compare));
+  std::sort(vec.begin(), vec.end());
+  std::vector<int32_t> expected(data.begin(), data.end());
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(vec, expected);
+}
+
+template <typename Compare>
+void projection_test(const std::vector<int32_t>& data, const size_t chunk_size, Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out1(std::stringstream(), data.size());
+  tape::tape out2(std::stringstream(), data.size());
+  auto tmps = make_tapes(std::vector<std::stringstream>(3), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::sort(in, out1, tmps[0], tmps[1], tmps[2], chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  expect_sorted(out1, data, compare);
+
+  tape::sort(in, out2, std::span(tmps), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  expect_sorted(out2, data, compare);
+}
+
+TEST(projection_tests, sort) {
+  for (size_t i = 0; i < 5; ++i) {
+    const auto data = gen_data<N>();
+    const std::vector<int32_t> vec(data.begin(), data.end());
+    for (size_t chunk = 1; chunk < N; chunk *= 4) {
+      projection_test(vec, chunk, tape::by_key(bit_cnt_key));
+      projection_test(vec, chunk, tape::by_key(mod_key));
+      projection_test(vec, chunk, tape::by_key(unsigned_key));
+      projection_test(vec, chunk, tape::by_key(counted_key));
+      projection_test(vec, chunk, tape::by_key(std::function<size_t(int32_t)>(bit_cnt_key)));
+    }
+  }
+}
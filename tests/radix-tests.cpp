@@ -0,0 +1,96 @@
+#include "../lib/include/radix.h"
+#include "helpers.h"
+
+#include <bit>
+
+constexpr size_t N = 100;
+
+TEST(radix_tests, key) {
+  static_assert(tape::radix_compatible<std::less<int32_t>>);
+  static_assert(tape::radix_compatible<std::greater<int32_t>>);
+  static_assert(!tape::radix_compatible<std::function<bool(int32_t, int32_t)>>);
+  static_assert(!tape::radix_compatible<decltype(bit_cnt_cmp)>);
+
+  auto data = gen_data<N>();
+  data[0] = std::numeric_limits<int32_t>::min();
+  data[1] = std::numeric_limits<int32_t>::max();
+  data[2] = 0;
+  data[3] = -1;
+  for (const auto l : data) {
+    for (const auto r : data) {
+      using less_key = tape::radix_key<std::less<int32_t>>;
+      using greater_key = tape::radix_key<std::greater<int32_t>>;
+      EXPECT_EQ(l < r, less_key::key(l) < less_key::key(r));
+      EXPECT_EQ(l > r, greater_key::key(l) < greater_key::key(r));
+    }
+  }
+}
+
+template <typename T, typename Compare>
+void radix_test(std::vector<T> tmp_streams, const std::vector<int32_t>& data, const size_t chunk_size,
+                Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  auto tmps = make_tapes(std::move(tmp_streams), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::radix_sort(in, out, std::span(tmps), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  for (auto& tmp : tmps) {
+    EXPECT_TRUE(tmp.is_begin());
+  }
+  expect_sorted(out, data, compare);
+}
+
+/**
+ * @return count of the elements read from the temporary tapes by the @code radix_sort()@endcode of @code data@endcode
+ * with @code tapes@endcode temporary tapes.
+ */
+template <typename Compare>
+size_t radix_reads(const std::vector<int32_t>& data, const size_t tapes, const size_t chunk_size, Compare compare) {
+  size_t reads = 0;
+  std::vector<counting_stream> streams;
+  for (size_t i = 0; i < tapes; ++i) {
+    streams.emplace_back(reads);
+  }
+  radix_test(std::move(streams), data, chunk_size, compare);
+  return reads;
+}
+
+TEST(radix_tests, passes) {
+  constexpr size_t M = 4000;
+  constexpr size_t CHUNK = 10;
+  std::mt19937 gen(std::random_device{}());
+  const auto data = gen_data<M>();
+  const std::vector<int32_t> random(data.begin(), data.end());
+  for (const size_t tapes : {size_t{3}, size_t{5}, size_t{9}}) {
+    // each pass handles floor(log2(tapes - 1)) bits
+    const size_t bits = std::bit_width(tapes - 1) - 1;
+    for (const size_t chunk : chunk_sizes(M, 8)) {
+      EXPECT_LE(radix_reads(random, tapes, chunk, std::less<int32_t>()), ((32 + bits - 1) / bits + 1) * M);
+    }
+
+    // the keys differ in the 4 low bits only, so the common high bits are skipped wherever the keys are. The keys
+    // around 0 differ in the sign bit, which takes one more pass to split them
+    for (const int32_t base : {std::numeric_limits<int32_t>::min(), -8, 1 << 20,
+                               std::numeric_limits<int32_t>::max() - 15}) {
+      std::vector<int32_t> narrow(M);
+      for (auto& v : narrow) {
+        v = base + static_cast<int32_t>(gen() % 16);
+      }
+      const size_t passes = (4 + bits - 1) / bits + (base == -8 ? 1 : 0);
+      EXPECT_LE(radix_reads(narrow, tapes, CHUNK, std::less<int32_t>()), passes * M);
+      EXPECT_LE(radix_reads(narrow, tapes, CHUNK, std::greater<int32_t>()), passes * M);
+    }
+
+    // the equal keys have no differing bits
+    EXPECT_EQ(radix_reads(std::vector<int32_t>(M, -5), tapes, CHUNK, std::less<int32_t>()), 0);
+  }
+}
+
+TEST(radix_tests, files) {
+  std::vector<file_guard> guards;
+  const auto data = gen_data<N>();
+  radix_test(tmp_streams(guards, 3), std::vector<int32_t>(data.begin(), data.end()), 0, std::less<int32_t>());
+}
@@ -0,0 +1,88 @@
+#include "../lib/include/sample-sorter.h"
+#include "helpers.h"
+
+#include <bit>
+
+constexpr size_t N = 100;
+
+TEST(sample_sorter_tests, splitter_tree) {
+  for (size_t levels = 0; levels < 5; ++levels) {
+    for (const auto& cmp : comps) {
+      const auto data = gen_data<N>();
+      std::vector<int32_t> splitters(data.begin(), data.begin() + (1 << levels) - 1);
+      std::sort(splitters.begin(), splitters.end(), cmp);
+
+      const tape::helpers::splitter_tree tree(splitters, cmp);
+      EXPECT_EQ(tree.buckets(), size_t{1} << levels);
+      for (const auto v : data) {
+        const auto expected = std::upper_bound(splitters.begin(), splitters.end(), v, cmp) - splitters.begin();
+        EXPECT_EQ(tree.bucket(v), expected);
+      }
+      for (size_t bucket = 1; bucket < tree.buckets(); ++bucket) {
+        EXPECT_EQ(tree.lower_bound(bucket), splitters[bucket - 1]);
+      }
+    }
+  }
+}
+
+template <typename T, typename Compare>
+void sample_test(std::vector<T> tmp_streams, const std::vector<int32_t>& data, const size_t chunk_size,
+                 Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  auto tmps = make_tapes(std::move(tmp_streams), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::sample_sort(in, out, std::span(tmps), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  for (auto& tmp : tmps) {
+    EXPECT_TRUE(tmp.is_begin());
+  }
+  expect_sorted(out, data, compare);
+}
+
+/**
+ * @return count of the elements read from the temporary tapes by the @code sample_sort()@endcode of @code data@endcode
+ * with @code tapes@endcode temporary tapes.
+ */
+template <typename Compare>
+size_t sample_reads(const std::vector<int32_t>& data, const size_t tapes, const size_t chunk_size, Compare compare) {
+  size_t reads = 0;
+  std::vector<counting_stream> streams;
+  for (size_t i = 0; i < tapes; ++i) {
+    streams.emplace_back(reads);
+  }
+  sample_test(std::move(streams), data, chunk_size, compare);
+  return reads;
+}
+
+TEST(sample_sorter_tests, passes) {
+  constexpr size_t M = 20000;
+  const auto data = gen_data<M>();
+  const std::vector<int32_t> random(data.begin(), data.end());
+  std::vector<int32_t> few(M);
+  std::transform(random.begin(), random.end(), few.begin(), [](const int32_t v) { return v % 3; });
+  for (const size_t tapes : {3, 5, 9, 17}) {
+    for (const size_t chunk : {size_t{0}, size_t{100}}) {
+      // each pass splits the data into bit_floor(tapes - 1) buckets, so there are about log_{k-1}(M / chunk) passes
+      const size_t buckets = std::bit_floor(tapes - 1);
+      size_t passes = 0;
+      for (size_t size = M; size > std::max<size_t>(chunk, 1); size /= buckets) {
+        ++passes;
+      }
+      for (const auto& cmp : {comps[0], comps[1], comps[3]}) {
+        EXPECT_LE(sample_reads(random, tapes, chunk, cmp), (passes + 2) * M);
+        // the copies of the splitters are only counted, so the few distinct elements take about a single pass
+        EXPECT_LE(sample_reads(few, tapes, chunk, cmp), 2 * M);
+      }
+      EXPECT_EQ(sample_reads(std::vector<int32_t>(M, 3), tapes, chunk, cmp), 0);
+    }
+  }
+}
+
+TEST(sample_sorter_tests, files) {
+  std::vector<file_guard> guards;
+  const auto data = gen_data<N>();
+  sample_test(tmp_streams(guards, 3), std::vector<int32_t>(data.begin(), data.end()), 0, cmp);
+}
@@ -0,0 +1,172 @@
+#include "../lib/include/selection.h"
+#include "helpers.h"
+
+constexpr size_t N = 300;
+
+/**
+ * Checks that @code result@endcode are the elements of @code data@endcode equivalent to the elements of the
+ * @code ranks@endcode of the sorted @code data@endcode.
+ */
+template <typename Compare>
+void expect_selected(const std::vector<int32_t>& result, std::vector<int32_t> data, const std::vector<size_t>& ranks,
+                     Compare compare) {
+  ASSERT_EQ(result.size(), ranks.size());
+  std::sort(data.begin(), data.end(), compare);
+  for (size_t i = 0; i < ranks.size(); ++i) {
+    const int32_t expected = data[ranks[i]];
+    EXPECT_FALSE(compare(result[i], expected) || compare(expected, result[i]));
+    EXPECT_NE(std::find(data.begin(), data.end(), result[i]), data.end());
+  }
+}
+
+template <typename Compare>
+void select_test(const std::vector<int32_t>& data, const std::vector<size_t>& ranks, const size_t chunk_size,
+                 Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape tmp1(std::stringstream(), data.size());
+  tape::tape tmp2(std::stringstream(), data.size());
+  tape::tape tmp3(std::stringstream(), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  const auto result = tape::select(in, std::span(ranks), tmp1, tmp2, tmp3, chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  EXPECT_TRUE(tmp1.is_begin());
+  EXPECT_TRUE(tmp2.is_begin());
+  EXPECT_TRUE(tmp3.is_begin());
+  expect_selected(result, data, ranks, compare);
+
+  for (const size_t rank : ranks) {
+    const int32_t value = tape::nth_element(in, rank, tmp1, tmp2, tmp3, chunk_size, compare);
+    EXPECT_TRUE(in.is_begin());
+    expect_selected({value}, data, {rank}, compare);
+  }
+}
+
+TEST(selection_tests, boundaries) {
+  // runs of the equal elements, so the ranks around the ends of the runs fall on the bounds of the splits
+  constexpr size_t RUN = 37;
+  std::vector<int32_t> data(N * 10);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<int32_t>(i / RUN);
+  }
+  std::shuffle(data.begin(), data.end(), std::mt19937(std::random_device{}()));
+
+  std::vector<size_t> ranks;
+  for (size_t end = RUN; end < data.size(); end += RUN) {
+    ranks.insert(ranks.end(), {end - 1, end});
+  }
+  for (const size_t chunk : {size_t{0}, size_t{10}, size_t{100}, N}) {
+    select_test(data, ranks, chunk, cmp);
+    select_test(data, {0, data.size() - 1}, chunk, cmp);
+  }
+}
+
+TEST(selection_tests, equivalent) {
+  const auto data = gen_datasets<N>(7);
+  for (const std::function<bool(int32_t, int32_t)>& compare : std::vector<std::function<bool(int32_t, int32_t)>>{
+           mod_cmp<2>, mod_cmp<239>}) {
+    for (const auto& vec : {data.random, data.few}) {
+      auto sorted = vec;
+      std::sort(sorted.begin(), sorted.end(), compare);
+      std::vector<size_t> ranks{0, N - 1};
+      for (size_t i = 1; i < N; ++i) {
+        if (compare(sorted[i - 1], sorted[i])) {
+          ranks.insert(ranks.end(), {i - 1, i});
+        }
+      }
+      for (const size_t chunk : {size_t{0}, size_t{10}, N}) {
+        select_test(vec, ranks, chunk, compare);
+      }
+    }
+  }
+}
+
+TEST(selection_tests, equal) {
+  size_t reads = 0;
+  tape::tape in(counting_stream(reads), N);
+  tape::tape tmp1(counting_stream(reads), N);
+  tape::tape tmp2(counting_stream(reads), N);
+  tape::tape tmp3(counting_stream(reads), N);
+  tape::helpers::vec_to_tape(std::vector<int32_t>(N, 5), in);
+  in.seek(-N);
+
+  // the equal data is answered by the sample, so it is read once
+  const std::vector<size_t> ranks{0, N / 2, N - 1};
+  EXPECT_EQ(tape::select(in, std::span(ranks), tmp1, tmp2, tmp3), std::vector<int32_t>(3, 5));
+  EXPECT_EQ(reads, N);
+  EXPECT_TRUE(in.is_begin());
+  EXPECT_TRUE(tmp1.is_begin());
+}
+
+TEST(selection_tests, passes) {
+  constexpr size_t M = 100000;
+  std::vector<int32_t> data(M);
+  std::iota(data.begin(), data.end(), 0);
+  std::shuffle(data.begin(), data.end(), std::mt19937(std::random_device{}()));
+
+  size_t reads = 0;
+  tape::tape in(counting_stream(reads), M);
+  tape::tape tmp1(counting_stream(reads), M);
+  tape::tape tmp2(counting_stream(reads), M);
+  tape::tape tmp3(counting_stream(reads), M);
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-M);
+
+  // the median is bracketed by the sample of the first pass, so the most of the data is read twice
+  const std::vector<double> median{0.5};
+  EXPECT_EQ(tape::quantiles(in, std::span(median), tmp1, tmp2, tmp3, 4000), std::vector<int32_t>{(M - 1) / 2});
+  EXPECT_LE(reads, 3 * M);
+  EXPECT_TRUE(in.is_begin());
+
+  // all the percentiles are narrowed by the same passes, so their count does not multiply the passes
+  reads = 0;
+  std::vector<double> levels;
+  for (size_t i = 1; i < 100; ++i) {
+    levels.push_back(static_cast<double>(i) / 100);
+  }
+  const auto result = tape::quantiles(in, std::span(levels), tmp1, tmp2, tmp3, 4000);
+  for (size_t i = 0; i < levels.size(); ++i) {
+    EXPECT_EQ(result[i], static_cast<int32_t>(std::floor(levels[i] * (M - 1))));
+  }
+  EXPECT_LE(reads, 5 * M);
+  EXPECT_TRUE(in.is_begin());
+}
+
+TEST(selection_tests, quantiles) {
+  constexpr size_t M = 100001;
+  std::vector<int32_t> data(M);
+  std::iota(data.begin(), data.end(), 0);
+  std::shuffle(data.begin(), data.end(), std::mt19937(std::random_device{}()));
+
+  tape::tape in(std::stringstream(), M);
+  tape::tape tmp1(std::stringstream(), M);
+  tape::tape tmp2(std::stringstream(), M);
+  tape::tape tmp3(std::stringstream(), M);
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-M);
+
+  const std::vector<double> levels{0.5, 0.99, 0, 1, 0.25};
+  const auto result = tape::quantiles(in, std::span(levels), tmp1, tmp2, tmp3, 1000);
+  EXPECT_EQ(result, std::vector<int32_t>({50000, 99000, 0, 100000, 25000}));
+  EXPECT_TRUE(in.is_begin());
+  EXPECT_TRUE(tmp1.is_begin());
+  EXPECT_TRUE(tmp2.is_begin());
+  EXPECT_TRUE(tmp3.is_begin());
+}
+
+TEST(selection_tests, invalid) {
+  tape::tape in(std::stringstream(), N);
+  tape::tape tmp1(std::stringstream(), N);
+  tape::tape tmp2(std::stringstream(), N);
+  tape::tape tmp3(std::stringstream(), N);
+
+  EXPECT_THROW(tape::nth_element(in, N, tmp1, tmp2, tmp3), std::out_of_range);
+  EXPECT_TRUE(in.is_begin());
+  const std::vector<double> levels{1.5};
+  EXPECT_THROW(tape::quantiles(in, std::span(levels), tmp1, tmp2, tmp3), std::invalid_argument);
+
+  tape::tape empty(std::stringstream(), 0);
+  const std::vector<double> median{0.5};
+  EXPECT_THROW(tape::quantiles(empty, std::span(median), tmp1, tmp2, tmp3), std::out_of_range);
+}
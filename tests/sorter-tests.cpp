@@ -3,27 +3,7 @@
 
 constexpr size_t N = 100;
 
-auto cmp = std::less<int32_t>{};
-auto rev_cmp = std::greater<int32_t>{};
-
-template <size_t MOD>
-auto mod_cmp = [](const int32_t l, const int32_t r) { return (l % MOD) < (r % MOD); };
-
-size_t bit_cnt(uint32_t v) {
-  size_t res = 0;
-  while (v) {
-    res += v & 1;
-    v >>= 1;
-  }
-  return res;
-}
-
-auto bit_cnt_cmp = [](const int32_t l, const int32_t r) { return bit_cnt(l) < bit_cnt(r); };
-
-auto unsigned_cmp = [](const uint32_t l, const uint32_t r) { return l < r; };
-
-std::vector<std::function<bool(int32_t, int32_t)>> comps{cmp,          rev_cmp,     mod_cmp<2>,
-                                                         mod_cmp<239>, bit_cnt_cmp, unsigned_cmp};
+tape::helpers::random_generator gen(std::random_device{}());
 
 template <typename T, typename Compare>
 void check_part(tape::tape<T>& src, const tape::helpers::subarray_info<Compare> info,
@@ -54,15 +34,19 @@ void split_test(SrcStream src_stream, LeftStream left_stream, RightStream right_
   tape::tape right(std::move(right_stream), N);
 
   auto data = gen_data<N>();
-  fill(src, data);
   const auto key = data[N / 2] + 1;
+  data[0] = data[N - 1] = key;
+  fill(src, data);
 
-  auto [linfo, rinfo] = tape::helpers::split(src, left, right, compare, key, N);
+  auto [linfo, equal, rinfo] = tape::helpers::split(src, left, right, compare, key, N, gen);
   EXPECT_TRUE(src.is_begin());
 
   check_part(left, linfo, filtered(data.begin(), N, [compare, key](int32_t v) { return compare(v, key); }));
 
-  check_part(right, rinfo, filtered(data.begin(), N, [compare, key](int32_t v) { return !compare(v, key); }));
+  EXPECT_EQ(equal, std::count(data.begin(), data.end(), key));
+
+  check_part(right, rinfo,
+             filtered(data.begin(), N, [compare, key](int32_t v) { return !compare(v, key) && v != key; }));
 }
 
 TEST(sorter_tests, split) {
@@ -81,6 +65,35 @@ TEST(sorter_tests, split) {
   }
 }
 
+TEST(sorter_tests, split_buffer) {
+  for (size_t i = 0; i < 10; ++i) {
+    for (const auto& cmp : comps) {
+      const auto data = gen_data<N>();
+      const auto key = data[N / 2];
+      const auto expected = filtered(data.begin(), N, [cmp, key](int32_t v) { return cmp(v, key); });
+
+      for (const size_t buffer_size : {expected.size() - 1, expected.size(), N}) {
+        tape::tape src(std::stringstream(), N);
+        tape::tape left(std::stringstream(), N);
+        tape::tape right(std::stringstream(), N);
+        fill(src, data);
+
+        std::vector<int32_t> buffer;
+        auto [linfo, equal, rinfo] = tape::helpers::split(src, left, right, cmp, key, N, gen, buffer, buffer_size);
+        EXPECT_EQ(linfo.size(), expected.size());
+        if (expected.size() <= buffer_size) {
+          EXPECT_TRUE(left.is_begin());
+          std::sort(buffer.begin(), buffer.end());
+          EXPECT_EQ(buffer, expected);
+        } else {
+          EXPECT_TRUE(buffer.empty());
+          check_part(left, linfo, expected);
+        }
+      }
+    }
+  }
+}
+
 template <typename InStream, typename OutStream, typename Compare, typename Sort>
 void sort_test(InStream in_stream, OutStream out_stream, Compare compare, Sort sort) {
   tape::tape in(std::move(in_stream), N);
@@ -92,16 +105,13 @@ void sort_test(InStream in_stream, OutStream out_stream, Compare compare, Sort s
 
   sort(in, out, compare);
 
-  auto vec = tape::helpers::tape_to_vec(out, N);
-  std::reverse(vec.begin(), vec.end());
-  for (size_t i = 0; i < N - 1; ++i) {
-    EXPECT_FALSE(compare(vec[i + 1], vec[i]));
-  }
+  expect_sorted(out, data, compare);
 }
 
 template <typename TIn, typename TOut, typename Compare>
 void sort_test1(TIn in_stream, TOut out_stream, Compare compare) {
-  sort_test(std::move(in_stream), std::move(out_stream), compare, &tape::sort<TIn, TOut, Compare>);
+  sort_test(std::move(in_stream), std::move(out_stream), compare,
+            [](tape::tape<TIn>& in, tape::tape<TOut>& out, Compare compare) { tape::sort(in, out, compare, 0); });
 }
 
 TEST(sorter_tests, sort1) {
@@ -159,11 +169,49 @@ TEST(sorter_tests, sort2) {
   }
 }
 
+template <typename Compare>
+void merge_sort_test(const std::vector<int32_t>& data, const size_t chunk_size, Compare compare) {
+  constexpr int32_t BOTTOM = 42;
+  tape::tape current(std::stringstream(), data.size() + 1);
+  tape::tape out(std::stringstream(), data.size());
+  tape::tape tmp1(std::stringstream(), data.size() + 1);
+  tape::tape tmp2(std::stringstream(), data.size() + 1);
+  for (auto* tmp : {&current, &tmp1, &tmp2}) {
+    tape::helpers::put(*tmp, BOTTOM);
+  }
+  tape::helpers::vec_to_tape(data, current);
+
+  tape::helpers::merge_sort_impl(out, current, tmp1, tmp2, data.size(), chunk_size, compare);
+  for (auto* tmp : {&current, &tmp1, &tmp2}) {
+    EXPECT_EQ(tape::helpers::peek(*tmp), BOTTOM);
+    EXPECT_TRUE(tmp->is_begin());
+  }
+  expect_sorted(out, data, compare);
+}
+
+TEST(sorter_tests, merge_sort) {
+  for (size_t i = 0; i < 10; ++i) {
+    for (const auto& cmp : comps) {
+      const auto data = gen_data<N>();
+      std::vector<int32_t> random(data.begin(), data.end());
+      std::vector<int32_t> sorted = random;
+      std::sort(sorted.begin(), sorted.end(), cmp);
+      std::vector<int32_t> reversed(sorted.rbegin(), sorted.rend());
+
+      for (const auto& vec : {random, sorted, reversed}) {
+        for (const size_t chunk : chunk_sizes(N, 2)) {
+          merge_sort_test(vec, chunk, cmp);
+        }
+      }
+    }
+  }
+}
+
 TEST(sorter_tests, uniform_distribution) {
   constexpr size_t REPEATS = 100000;
   std::array<size_t, N> hist{};
   for (size_t i = 0; i < REPEATS; ++i) {
-    tape::helpers::subarray_info info(cmp);
+    tape::helpers::subarray_info info(cmp, gen);
     for (int32_t n = 0; n < N; ++n) {
       info.update(n);
     }
@@ -173,4 +221,63 @@ TEST(sorter_tests, uniform_distribution) {
   for (size_t i = 0; i < N; ++i) {
     EXPECT_NEAR(hist[i], mean, mean / 2);
   }
-}
\ No newline at end of file
+}
+
+TEST(sorter_tests, sample_distribution) {
+  constexpr size_t REPEATS = 10000;
+  constexpr size_t SAMPLE = 10;
+  std::array<size_t, N> hist{};
+  for (size_t i = 0; i < REPEATS; ++i) {
+    tape::helpers::subarray_info info(cmp, gen, SAMPLE);
+    for (size_t n = 0; n < N; ++n) {
+      info.update(static_cast<int32_t>(n));
+    }
+    auto sample = info.sample();
+    ASSERT_EQ(sample.size(), SAMPLE);
+    std::sort(sample.begin(), sample.end());
+    EXPECT_EQ(std::unique(sample.begin(), sample.end()), sample.end());
+    for (const auto v : sample) {
+      ++hist[v];
+    }
+  }
+  const double mean = REPEATS * 1.0 * SAMPLE / N;
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_NEAR(hist[i], mean, mean / 2);
+  }
+}
+
+TEST(sorter_tests, quantiles) {
+  tape::helpers::subarray_info info(cmp, gen, N);
+  for (int32_t n = N - 1; n >= 0; --n) {
+    info.update(n);
+  }
+  EXPECT_EQ(info.median(), N / 2);
+  EXPECT_EQ(info.quantiles(2), std::vector<int32_t>({N / 2}));
+  EXPECT_EQ(info.quantiles(4), std::vector<int32_t>({N / 4, N / 2, 3 * N / 4}));
+
+  tape::helpers::subarray_info rev_info(rev_cmp, gen, N);
+  for (size_t n = 0; n < N; ++n) {
+    rev_info.update(static_cast<int32_t>(n));
+  }
+  EXPECT_EQ(rev_info.quantiles(4), std::vector<int32_t>({3 * N / 4 - 1, N / 2 - 1, N / 4 - 1}));
+}
+
+TEST(sorter_tests, skipping_sample_distribution) {
+  constexpr size_t REPEATS = 2000;
+  constexpr size_t SAMPLE = 10;
+  constexpr size_t SIZE = 10000;
+  std::array<size_t, 10> hist{};
+  for (size_t i = 0; i < REPEATS; ++i) {
+    tape::helpers::subarray_info info(cmp, gen, SAMPLE);
+    for (size_t n = 0; n < SIZE; ++n) {
+      info.update(static_cast<int32_t>(n));
+    }
+    for (const auto v : info.sample()) {
+      ++hist[v * hist.size() / SIZE];
+    }
+  }
+  const double mean = REPEATS * 1.0 * SAMPLE / hist.size();
+  for (const auto count : hist) {
+    EXPECT_NEAR(count, mean, mean / 4);
+  }
+}
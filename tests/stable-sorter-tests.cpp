@@ -0,0 +1,93 @@
+#include "../lib/include/projection.h"
+#include "../lib/include/stable-sorter.h"
+#include "helpers.h"
+
+constexpr size_t N = 100;
+
+template <typename Compare>
+void stable_leaf_test(std::vector<int32_t> data, Compare compare, const size_t scratch_size) {
+  auto expected = data;
+  std::stable_sort(expected.begin(), expected.end(), compare);
+  tape::helpers::stable_sort_leaf(data, compare, scratch_size);
+  EXPECT_EQ(data, expected);
+}
+
+TEST(stable_sorter_tests, leaf) {
+  const auto data = gen_data<3 * tape::helpers::LEAF_RADIX_MIN_SIZE>();
+  std::vector<int32_t> vec(data.begin(), data.end());
+  for (const size_t scratch : {size_t{0}, 4 * vec.size()}) {
+    for (const auto& cmp : comps) {
+      stable_leaf_test(vec, cmp, scratch);
+    }
+    stable_leaf_test(vec, mod_cmp<239>, scratch);
+    stable_leaf_test(vec, tape::by_key([](const int32_t v) { return v % 239; }), scratch);
+    stable_leaf_test(vec, tape::by_key([](const int32_t v) { return bit_cnt(v); }), scratch);
+  }
+}
+
+TEST(stable_sorter_tests, passes) {
+  EXPECT_EQ(tape::helpers::stable_passes(2, 2, 1), 1);
+  EXPECT_EQ(tape::helpers::stable_passes(3, 2, 1), 3);
+  EXPECT_EQ(tape::helpers::stable_passes(4, 2, 1), 3);
+  EXPECT_EQ(tape::helpers::stable_passes(5, 2, 1), 5);
+  EXPECT_EQ(tape::helpers::stable_passes(9, 3, 3), 2);
+  EXPECT_EQ(tape::helpers::stable_passes(10, 3, 3), 3);
+}
+
+template <typename T, typename Compare>
+void stable_test(std::vector<T> tmp_streams, const std::vector<int32_t>& data, const size_t chunk_size,
+                 Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  auto tmps = make_tapes(std::move(tmp_streams), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  tape::stable_sort(in, out, std::span(tmps), chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  for (auto& tmp : tmps) {
+    EXPECT_TRUE(tmp.is_begin());
+  }
+
+  auto expected = data;
+  std::stable_sort(expected.begin(), expected.end(), compare);
+  auto result = tape::helpers::tape_to_vec(out, data.size());
+  std::reverse(result.begin(), result.end());
+  EXPECT_EQ(result, expected);
+}
+
+TEST(stable_sorter_tests, ties) {
+  // the elements are the positions with the random keys in the low digit, so the equivalent elements are ordered by
+  // their positions in the input, and the reversed input orders them backwards
+  constexpr int32_t KEYS = 7;
+  std::mt19937 gen(std::random_device{}());
+  std::vector<int32_t> data(N);
+  for (size_t i = 0; i < N; ++i) {
+    data[i] = static_cast<int32_t>(i) * KEYS + static_cast<int32_t>(gen() % KEYS);
+  }
+  const std::vector<int32_t> reversed(data.rbegin(), data.rend());
+  const auto by_digit = [](const int32_t l, const int32_t r) { return l % KEYS < r % KEYS; };
+  const auto by_digit_desc = [](const int32_t l, const int32_t r) { return l % KEYS > r % KEYS; };
+
+  for (size_t tapes = 3; tapes < 9; ++tapes) {
+    for (const size_t chunk : chunk_sizes(N, 2)) {
+      for (const auto& vec : {data, reversed}) {
+        stable_test(std::vector<std::stringstream>(tapes), vec, chunk, by_digit);
+        stable_test(std::vector<std::stringstream>(tapes), vec, chunk, by_digit_desc);
+        stable_test(std::vector<std::stringstream>(tapes), vec, chunk,
+                    tape::by_key([](const int32_t v) { return v % KEYS; }));
+      }
+    }
+  }
+
+  // all the elements are equivalent, so the output is the input
+  for (const size_t chunk : chunk_sizes(N, 2)) {
+    stable_test(std::vector<std::stringstream>(3), data, chunk, [](int32_t, int32_t) { return false; });
+  }
+}
+
+TEST(stable_sorter_tests, files) {
+  std::vector<file_guard> guards;
+  const auto data = gen_data<N>();
+  stable_test(tmp_streams(guards, 3), std::vector<int32_t>(data.begin(), data.end()), 1, mod_cmp<2>);
+}
@@ -0,0 +1,154 @@
+#include "../lib/include/unique-sorter.h"
+#include "helpers.h"
+
+#include <numeric>
+
+constexpr size_t N = 100;
+
+/**
+ * Checks that the elements before the @code out@endcode head are the representatives of the groups of the
+ * equivalent elements of @code data@endcode in the sorted order and the @code counts@endcode are the sizes of the
+ * groups.
+ */
+template <typename Stream, typename Compare>
+void expect_unique(tape::tape<Stream>& out, tape::tape<Stream>& counts, const size_t size, std::vector<int32_t> data,
+                   Compare compare) {
+  std::sort(data.begin(), data.end(), compare);
+  std::vector<int32_t> keys;
+  std::vector<int32_t> expected_counts;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (i == 0 || compare(data[i - 1], data[i])) {
+      keys.push_back(data[i]);
+      expected_counts.push_back(0);
+    }
+    ++expected_counts.back();
+  }
+
+  ASSERT_EQ(size, keys.size());
+  auto result = tape::helpers::tape_to_vec(out, size);
+  auto result_counts = tape::helpers::tape_to_vec(counts, size);
+  std::reverse(result.begin(), result.end());
+  std::reverse(result_counts.begin(), result_counts.end());
+  for (size_t i = 0; i < size; ++i) {
+    EXPECT_FALSE(compare(result[i], keys[i]) || compare(keys[i], result[i]));
+    EXPECT_NE(std::find(data.begin(), data.end(), result[i]), data.end());
+  }
+  EXPECT_EQ(result_counts, expected_counts);
+}
+
+template <typename Compare>
+void unique_test(const std::vector<int32_t>& data, const size_t chunk_size, Compare compare) {
+  tape::tape in(std::stringstream(), data.size());
+  tape::tape out(std::stringstream(), data.size());
+  tape::tape counts(std::stringstream(), data.size());
+  tape::tape tmp1(std::stringstream(), data.size());
+  tape::tape tmp2(std::stringstream(), data.size());
+  tape::tape tmp3(std::stringstream(), data.size());
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-data.size());
+
+  const size_t size = tape::unique_sort(in, out, counts, tmp1, tmp2, tmp3, chunk_size, compare);
+  EXPECT_TRUE(in.is_begin());
+  EXPECT_TRUE(tmp1.is_begin());
+  EXPECT_TRUE(tmp2.is_begin());
+  EXPECT_TRUE(tmp3.is_begin());
+  expect_unique(out, counts, size, data, compare);
+
+  tape::tape unique_out(std::stringstream(), data.size());
+  EXPECT_EQ(tape::unique_sort(in, unique_out, tmp1, tmp2, tmp3, chunk_size, compare), size);
+  EXPECT_TRUE(in.is_begin());
+}
+
+TEST(unique_sorter_tests, groups) {
+  // the groups of the sizes from 1 to GROUPS, so the large groups span several chunks, runs and parts of the splits
+  constexpr int32_t GROUPS = 20;
+  std::vector<int32_t> data;
+  for (int32_t g = 0; g < GROUPS; ++g) {
+    data.insert(data.end(), g + 1, g * 1000 - 7);
+  }
+  std::shuffle(data.begin(), data.end(), std::mt19937(std::random_device{}()));
+  std::vector<int32_t> sorted = data;
+  std::sort(sorted.begin(), sorted.end());
+
+  for (const size_t chunk : chunk_sizes(data.size(), 2)) {
+    for (const auto& vec : {data, sorted}) {
+      unique_test(vec, chunk, cmp);
+      unique_test(vec, chunk, rev_cmp);
+      // the different elements are equivalent, so the groups are merged
+      unique_test(vec, chunk, mod_cmp<2>);
+    }
+    unique_test(std::vector<int32_t>(N, 5), chunk, cmp);
+  }
+
+  // all the groups are single elements
+  std::vector<int32_t> distinct(N);
+  std::iota(distinct.begin(), distinct.end(), -static_cast<int32_t>(N / 2));
+  std::shuffle(distinct.begin(), distinct.end(), std::mt19937(std::random_device{}()));
+  for (const size_t chunk : chunk_sizes(N, 2)) {
+    unique_test(distinct, chunk, cmp);
+  }
+}
+
+TEST(unique_sorter_tests, few_distinct) {
+  std::vector<int32_t> data(N);
+  for (size_t i = 0; i < N; ++i) {
+    data[i] = static_cast<int32_t>(i * i % 5);
+  }
+
+  // the few distinct elements are counted in memory while the data is read, so the temporary tapes are not read
+  size_t reads = 0;
+  tape::tape in(std::stringstream(), N);
+  tape::tape out(std::stringstream(), N);
+  tape::tape counts(std::stringstream(), N);
+  tape::tape tmp1(counting_stream(reads), N);
+  tape::tape tmp2(counting_stream(reads), N);
+  tape::tape tmp3(counting_stream(reads), N);
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-N);
+
+  const size_t size = tape::unique_sort(in, out, counts, tmp1, tmp2, tmp3, 10);
+  EXPECT_EQ(reads, 0);
+  EXPECT_TRUE(in.is_begin());
+  expect_unique(out, counts, size, data, cmp);
+}
+
+TEST(unique_sorter_tests, merge) {
+  for (const auto& cmp : comps) {
+    const auto vec = gen_datasets<N>(5).few;
+
+    tape::tape current(std::stringstream(), N);
+    tape::tape tmp1(std::stringstream(), N);
+    tape::tape tmp2(std::stringstream(), N);
+    tape::tape out(std::stringstream(), N);
+    tape::tape counts(std::stringstream(), N);
+    tape::helpers::vec_to_tape(vec, current);
+
+    tape::helpers::unique_writer writer(out, &counts, cmp);
+    tape::helpers::merge_sort_impl(writer, current, tmp1, tmp2, N, 3, cmp);
+    writer.flush();
+    expect_unique(out, counts, writer.size(), vec, cmp);
+  }
+}
+
+TEST(unique_sorter_tests, files) {
+  std::vector<file_guard> guards;
+  const file_guard fin(get_file_name("in"));
+  const file_guard fout(get_file_name("out"));
+  auto tmps = make_tapes(tmp_streams(guards, 3), N);
+
+  std::vector<int32_t> data(N);
+  for (size_t i = 0; i < N; ++i) {
+    data[i] = static_cast<int32_t>(i * i % 17);
+  }
+  tape::tape in(std::fstream(fin.path()), N);
+  tape::tape out(std::fstream(fout.path()), N);
+  tape::helpers::vec_to_tape(data, in);
+  in.seek(-N);
+
+  std::sort(data.begin(), data.end());
+  data.erase(std::unique(data.begin(), data.end()), data.end());
+  ASSERT_EQ(tape::unique_sort(in, out, tmps[0], tmps[1], tmps[2], 4), data.size());
+  auto result = tape::helpers::tape_to_vec(out, data.size());
+  std::reverse(result.begin(), result.end());
+  EXPECT_EQ(result, data);
+}
@@ -1,12 +1,22 @@
+#include "../lib/include/adaptive-sorter.h"
+#include "../lib/include/merger.h"
+#include "../lib/include/parallel-sorter.h"
 #include "../lib/include/sorter.h"
 #include "../lib/include/tape.h"
+#include "../lib/include/unique-sorter.h"
 #include "../utilities/include/file-guard.h"
 
 #include <fstream>
 #include <iostream>
+#include <thread>
 
-const std::string CALL_FORMAT = "tape-sort <input-file> <output-file> [input-tape-size] [memory-limit]";
+const std::string CALL_FORMAT =
+    "tape-sort [--threads <count>] [--partitions <count>] [--unique] "
+    "<input-file> <output-file> [input-tape-size] [memory-limit]\n"
+    "tape-sort merge [--memory <memory-limit>] <output-file> <input-file>...";
 const std::string CONFIG_PATH = "config.txt";
+constexpr size_t TMP_COUNT = 3;
+constexpr size_t SET_SIZE = 5;
 
 bool parse_delays(tape::delay_config& config) {
   std::ifstream fconfig(CONFIG_PATH);
@@ -75,31 +85,132 @@ std::string get_tmp_path() {
   return "./tmp/tmp_" + std::to_string(distribution(gen)) + ".txt";
 }
 
+int merge_files(const std::vector<std::string>& args, const size_t memory, const tape::delay_config& delays) {
+  if (args.empty()) {
+    std::cerr << "the output file expected:" << std::endl << CALL_FORMAT << std::endl;
+    return 1;
+  }
+
+  size_t N = 0;
+  std::vector<tape::tape<std::ifstream>> ins;
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::ifstream fin(args[i]);
+    if (!fin) {
+      std::cerr << "error opening the input file " << args[i] << std::endl;
+      return 1;
+    }
+    fin.seekg(0, std::ios_base::end);
+    const size_t bytes = fin.tellg();
+    if (bytes % 4 != 0) {
+      std::cout << "input data of " << args[i] << " can't be split by integers. the tail will be discarded"
+                << std::endl;
+    }
+    const size_t size = bytes / sizeof(int32_t);
+    fin.seekg(0, std::ios_base::beg);
+    ins.emplace_back(std::move(fin), size, delays);
+    N += size;
+  }
+
+  std::ofstream fout(args[0], std::ios_base::out | std::ios_base::trunc);
+  if (!fout) {
+    std::cerr << "error opening the output file" << std::endl;
+    return 1;
+  }
+  tape::tape tout(std::move(fout), N, delays);
+
+  try {
+    tape::merge(std::span(ins), tout, memory / sizeof(int32_t));
+    tout.flush();
+  } catch (tape::unsorted_exception& e) {
+    std::cerr << "the input is not sorted: " << e.what() << std::endl;
+    return 1;
+  } catch (tape::io_exception& e) {
+    std::cerr << "i/o error occurred while working with the tapes: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
 int main(const int argc, char* argv[]) {
-  if (argc > 5) {
+  std::vector<std::string> args;
+  size_t threads = 1;
+  size_t partitions = 1;
+  size_t memory = 0;
+  bool unique = false;
+  // the last flags given, which are applicable only in the sort or the merge mode
+  std::string sort_flag;
+  std::string merge_flag;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--unique" || arg == "--threads" || arg == "--partitions") {
+      sort_flag = arg;
+    } else if (arg == "--memory") {
+      merge_flag = arg;
+    }
+
+    if (arg == "--unique") {
+      unique = true;
+    } else if (arg == "--memory") {
+      if (i + 1 == argc) {
+        std::cerr << "the memory limit expected:" << std::endl << CALL_FORMAT << std::endl;
+        return 1;
+      }
+      if (!get_uint_param(argv[++i], memory, "memory limit")) {
+        return 1;
+      }
+    } else if (arg != "--threads" && arg != "--partitions") {
+      args.push_back(arg);
+    } else if (i + 1 == argc) {
+      std::cerr << "the count of " << arg.substr(2) << " expected:" << std::endl << CALL_FORMAT << std::endl;
+      return 1;
+    } else if (!get_uint_param(argv[++i], arg == "--threads" ? threads : partitions, "count of " + arg.substr(2))) {
+      return 1;
+    }
+  }
+
+  const bool merge_mode = !args.empty() && args[0] == "merge";
+  if (const std::string& flag = merge_mode ? sort_flag : merge_flag; !flag.empty()) {
+    std::cerr << "the flag " << flag << " is not applicable in the " << (merge_mode ? "merge" : "sort") << " mode:"
+              << std::endl
+              << CALL_FORMAT << std::endl;
+    return 1;
+  }
+
+  if (merge_mode) {
+    tape::delay_config delays{};
+    if (!parse_delays(delays)) {
+      return 1;
+    }
+    return merge_files(std::vector(args.begin() + 1, args.end()), memory, delays);
+  }
+
+  if (args.size() > 4) {
     std::cerr << "too many arguments:" << std::endl << CALL_FORMAT << std::endl;
     return 1;
   }
-  if (argc < 3) {
+  if (args.size() < 2) {
     std::cerr << "the input and output files expected:" << std::endl << CALL_FORMAT << std::endl;
     return 1;
   }
+  if (threads == 0) {
+    threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+  }
 
-  std::ifstream fin(argv[1]);
+  std::ifstream fin(args[0]);
   if (!fin) {
     std::cerr << "error opening the input file" << std::endl;
     return 1;
   }
 
-  std::ofstream fout(argv[2], std::ios_base::out | std::ios_base::trunc);
+  std::ofstream fout(args[1], std::ios_base::out | std::ios_base::trunc);
   if (!fout) {
     std::cerr << "error opening the output file" << std::endl;
     return 1;
   }
 
   size_t N;
-  if (argc > 3) {
-    if (!get_uint_param(argv[3], N, "input tape size")) {
+  if (args.size() > 2) {
+    if (!get_uint_param(args[2], N, "input tape size")) {
       return 1;
     }
   } else {
@@ -113,8 +224,8 @@ int main(const int argc, char* argv[]) {
   }
 
   size_t M = 0;
-  if (argc > 4) {
-    if (!get_uint_param(argv[4], M, "memory limit")) {
+  if (args.size() > 3) {
+    if (!get_uint_param(args[3], M, "memory limit")) {
       return 1;
     }
   }
@@ -130,23 +241,54 @@ int main(const int argc, char* argv[]) {
   tape::tape tout(std::move(fout), N, delays);
 
   try {
-    if (N <= chunk_size) {
-      sort(tin, tout);
-    } else {
-      file_guard tmp1_guard(get_tmp_path()), tmp2_guard(get_tmp_path()), tmp3_guard(get_tmp_path());
-      std::fstream ftmp1(tmp1_guard.path());
-      std::fstream ftmp2(tmp2_guard.path());
-      std::fstream ftmp3(tmp3_guard.path());
-      if (!ftmp1 || !ftmp2 || !ftmp3) {
-        std::cerr << "error opening temporary file";
-        return 1;
+    if (N <= chunk_size && !unique) {
+      // the rest of the memory limit is left for the scratch of the in-memory sort
+      sort(tin, tout, std::less<int32_t>(), chunk_size - N, threads);
+    } else if (partitions > 1 && !unique) {
+      std::vector<file_guard> tmp_guards;
+      std::vector<std::vector<tape::tape<std::fstream>>> sets(partitions);
+      for (auto& set : sets) {
+        for (size_t i = 0; i < SET_SIZE; ++i) {
+          tmp_guards.emplace_back(get_tmp_path());
+          std::fstream ftmp(tmp_guards.back().path());
+          if (!ftmp) {
+            std::cerr << "error opening temporary file";
+            return 1;
+          }
+          set.emplace_back(std::move(ftmp), N, delays);
+        }
       }
-      tape::tape tmp1(std::move(ftmp1), N, delays);
-      tape::tape tmp2(std::move(ftmp2), N, delays);
-      tape::tape tmp3(std::move(ftmp3), N, delays);
 
-      sort(tin, tout, tmp1, tmp2, tmp3, chunk_size);
+      parallel_sort(tin, tout, std::span(sets), chunk_size, std::less<int32_t>(), threads);
       tout.flush();
+    } else {
+      std::vector<file_guard> tmp_guards;
+      std::vector<tape::tape<std::fstream>> tmps;
+      for (size_t i = 0; i < TMP_COUNT; ++i) {
+        tmp_guards.emplace_back(get_tmp_path());
+        std::fstream ftmp(tmp_guards.back().path());
+        if (!ftmp) {
+          std::cerr << "error opening temporary file";
+          return 1;
+        }
+        tmps.emplace_back(std::move(ftmp), N, delays);
+      }
+
+      if (unique) {
+        const size_t size =
+            unique_sort(tin, tout, tmps[0], tmps[1], tmps[2], chunk_size, std::less<int32_t>(), threads);
+        tout.flush();
+        // the output tape is extended to the size of the input, so the tail after the unique elements is cut
+        try {
+          std::filesystem::resize_file(args[1], size * sizeof(int32_t));
+        } catch (std::filesystem::filesystem_error& e) {
+          std::cerr << "error truncating the output file: " << e.what() << std::endl;
+          return 1;
+        }
+      } else {
+        sort(tin, tout, std::span(tmps), chunk_size, std::less<int32_t>(), threads);
+        tout.flush();
+      }
     }
   } catch (tape::io_exception& e) {
     std::cerr << "i/o error occurred while working with the tapes: " << e.what() << std::endl;